@@ -0,0 +1,364 @@
+/*bench.c
+  Throughput benchmark of the cache models (cachesim.h) on the synthetic patterns of synth.h. Every engine,
+  i.e. the direct-mapped cache, the k-way cache with each replacement policy and the fully associative LRU cache,
+  simulates every pattern in a child process of its own, so that the peak RSS reported is that of the engine.
+  Only cacheSimulateBatch is timed, the accesses are generated in batches in between. Each run is repeated and
+  the fastest repetition counts, which is the least disturbed by whatever else the machine was doing.
+  -o saves the results as a baseline, and -c compares a run with one and fails if any engine and pattern got
+  slower per access than the tolerance allows, to catch throughput regressions.
+  The output and the baseline name the tag match kernel of tagmatch.h in use, as a baseline taken on a CPU with
+  another one is not comparable.
+  How to execute:
+    1) gcc -O2 -o bench bench.c cachesim.c fullassoc.c policy.c synth.c tagmatch.c -lm
+    2) ./bench -o baseline.txt
+       ./bench -c baseline.txt -t 0.1
+        (fails if anything got more than 10% slower)
+       ./bench -n 10000000 -s 256 -k 16 -f 67108864
+        (10M accesses of each pattern through 256KB 16-way caches, over a 64MB footprint)
+  */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "cachesim.h"
+#include "policy.h"
+#include "synth.h"
+#include "tagmatch.h"
+
+#define BENCH_BATCH 16384 /*# of accesses generated, then simulated, at a time*/
+#define BENCH_ENGINES 16
+#define BENCH_NAME 32
+
+struct BenchEngine
+{
+    char name[BENCH_NAME];
+    struct CacheConfig config;
+};
+
+/*What a child reports back to the benchmark*/
+struct BenchResult
+{
+    int ok;
+    double seconds;
+    unsigned long accesses;
+    unsigned long misses;
+};
+
+/*A line of a baseline file*/
+struct BenchBaseline
+{
+    char engine[BENCH_NAME];
+    char pattern[BENCH_NAME];
+    double ns;
+    long rss;
+};
+
+static double benchNow(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double) now.tv_sec + now.tv_nsec * 1e-9;
+}
+
+/*Simulate count accesses of synth through engine, in the child process*/
+static struct BenchResult benchRun(const struct BenchEngine* engine, const struct SynthConfig* pattern,
+                                   unsigned long count)
+{
+    struct BenchResult result;
+    struct CacheStats stats;
+    struct Cache cache;
+    struct Synth synth;
+    struct TraceRecord* records = malloc(BENCH_BATCH * sizeof(*records));
+    const char* error;
+    unsigned long done;
+
+    memset(&result, 0, sizeof(result));
+    memset(&stats, 0, sizeof(stats));
+    if (records == NULL || cacheInit(&cache, &engine->config, &error) != 0)
+    {
+        return result;
+    }
+    if (synthInit(&synth, pattern) != 0)
+    {
+        cacheFree(&cache);
+        return result;
+    }
+    for (done = 0; done < count;)
+    {
+        int n = count - done < BENCH_BATCH ? (int) (count - done) : BENCH_BATCH;
+        double start;
+
+        synthFill(&synth, records, n);
+        start = benchNow();
+        cacheSimulateBatch(&cache, records, (size_t) n, (int64_t) done, &stats);
+        result.seconds += benchNow() - start;
+        done += (unsigned long) n;
+    }
+    result.ok = 1;
+    result.accesses = stats.dataAccesses;
+    result.misses = stats.readMisses + stats.writeMisses;
+    synthFree(&synth);
+    cacheFree(&cache);
+    free(records);
+    return result;
+}
+
+/*Run engine over pattern in a child process. Returns -1 if the child failed, rss is its peak RSS in KB*/
+static int benchFork(const struct BenchEngine* engine, const struct SynthConfig* pattern, unsigned long count,
+                     struct BenchResult* result, long* rss)
+{
+    struct rusage usage;
+    int fds[2];
+    int status;
+    pid_t pid;
+
+    if (pipe(fds) != 0)
+    {
+        return -1;
+    }
+    fflush(stdout);
+    pid = fork();
+    if (pid < 0)
+    {
+        return -1;
+    }
+    if (pid == 0)
+    {
+        struct BenchResult child = benchRun(engine, pattern, count);
+
+        close(fds[0]);
+        _exit(write(fds[1], &child, sizeof(child)) == (ssize_t) sizeof(child) ? 0 : 1);
+    }
+
+    close(fds[1]);
+    memset(result, 0, sizeof(*result));
+    if (read(fds[0], result, sizeof(*result)) != (ssize_t) sizeof(*result))
+    {
+        result->ok = 0;
+    }
+    close(fds[0]);
+    if (wait4(pid, &status, 0, &usage) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0 || !result->ok)
+    {
+        return -1;
+    }
+    *rss = usage.ru_maxrss;
+    return 0;
+}
+
+/*Read a baseline written with -o. Returns the # of lines read, -1 if filename could not be read*/
+static int benchLoad(const char* filename, struct BenchBaseline* lines, int max)
+{
+    char line[256];
+    FILE* in = fopen(filename, "r");
+    int n = 0;
+
+    if (in == NULL)
+    {
+        return -1;
+    }
+    while (n < max && fgets(line, sizeof(line), in) != NULL)
+    {
+        if (line[0] != '#' && sscanf(line, "%31s %31s %lf %ld", lines[n].engine, lines[n].pattern, &lines[n].ns,
+                                     &lines[n].rss) == 4)
+        {
+            n++;
+        }
+    }
+    fclose(in);
+    return n;
+}
+
+static void usage(void)
+{
+    printf("Arguments required: [-n accesses] [-s cachesize] [-k set-associativity] [-f footprint] [-w writes] "
+           "[-r repeats] [-o baseline] [-c baseline] [-t tolerance]\nExiting...\n");
+    exit(EXIT_FAILURE);
+}
+
+int main(int argc, char* argv[])
+{
+    static const char* const policies[] = {"lru", "plru", "srrip", "brrip", "fifo", "random"};
+    struct BenchEngine engines[BENCH_ENGINES];
+    struct BenchBaseline* baseline = NULL;
+    struct SynthConfig pattern = {SYNTH_SEQUENTIAL, 1 << 22, 64, 0.3, 0.99, 1};
+    unsigned long count = 1UL << 22;
+    int repeats = 3;
+    double cachesize = 32;
+    int k = 8;
+    const char* saveName = NULL;
+    const char* compareName = NULL;
+    double tolerance = 0.1;
+    FILE* save = NULL;
+    int baselines = 0;
+    int nengines = 0;
+    int regressions = 0;
+    int failures = 0;
+    int e;
+    int i;
+    int p;
+
+    for (i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc)
+        {
+            count = strtoul(argv[++i], NULL, 10);
+        }
+        else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc)
+        {
+            cachesize = atof(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-k") == 0 && i + 1 < argc)
+        {
+            k = (int) strtol(argv[++i], NULL, 10);
+        }
+        else if (strcmp(argv[i], "-f") == 0 && i + 1 < argc)
+        {
+            pattern.footprint = strtoull(argv[++i], NULL, 10);
+        }
+        else if (strcmp(argv[i], "-w") == 0 && i + 1 < argc)
+        {
+            pattern.writes = atof(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-r") == 0 && i + 1 < argc)
+        {
+            repeats = (int) strtol(argv[++i], NULL, 10);
+            if (repeats < 1)
+            {
+                usage();
+            }
+        }
+        else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc)
+        {
+            saveName = argv[++i];
+        }
+        else if (strcmp(argv[i], "-c") == 0 && i + 1 < argc)
+        {
+            compareName = argv[++i];
+        }
+        else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc)
+        {
+            tolerance = atof(argv[++i]);
+        }
+        else
+        {
+            usage();
+        }
+    }
+
+    /*The engines: one per kernel of cachesim.c that a configuration can select*/
+    memset(engines, 0, sizeof(engines));
+    snprintf(engines[nengines].name, BENCH_NAME, "direct");
+    engines[nengines++].config = (struct CacheConfig) {CACHE_DIRECT, cachesize, 1, NULL, 0};
+    for (i = 0; i < (int) (sizeof(policies) / sizeof(policies[0])); i++)
+    {
+        snprintf(engines[nengines].name, BENCH_NAME, "kway-%s", policies[i]);
+        engines[nengines++].config = (struct CacheConfig) {CACHE_KWAY, cachesize, k, policyFind(policies[i]), 0};
+    }
+    snprintf(engines[nengines].name, BENCH_NAME, "kway-legacy");
+    engines[nengines++].config = (struct CacheConfig) {CACHE_KWAY, cachesize, k, NULL, 0};
+    snprintf(engines[nengines].name, BENCH_NAME, "full-lru");
+    engines[nengines++].config = (struct CacheConfig) {CACHE_KWAY, cachesize, FULLY_ASSOCIATIVE, policyFind("lru"), 0};
+
+    if (compareName != NULL)
+    {
+        baseline = malloc(BENCH_ENGINES * SYNTH_PATTERNS * sizeof(*baseline));
+        if (baseline == NULL || (baselines = benchLoad(compareName, baseline, BENCH_ENGINES * SYNTH_PATTERNS)) < 0)
+        {
+            perror("Could not read the baseline");
+            exit(EXIT_FAILURE);
+        }
+    }
+    if (saveName != NULL)
+    {
+        save = fopen(saveName, "w");
+        if (save == NULL)
+        {
+            perror("Could not create the baseline");
+            exit(EXIT_FAILURE);
+        }
+        fprintf(save, "# engine pattern ns/access peakRSS(KB), %lu accesses, %gKB, k = %d, footprint %llu, "
+                "%s tag match\n", count, cachesize, k, (unsigned long long) pattern.footprint, tagMatchKernel());
+    }
+
+    printf("%lu accesses per run, best of %d, %gKB caches, k = %d, footprint of %llu bytes, %g%% stores, "
+           "%s tag match\n", count, repeats, cachesize, k, (unsigned long long) pattern.footprint,
+           100.0 * pattern.writes, tagMatchKernel());
+    printf("%-12s\t%-10s\t%12s\t%10s\t%10s\t%10s", "engine", "pattern", "accesses/s", "ns/access", "RSS (KB)",
+           "miss rate");
+    printf(compareName != NULL ? "\t%10s\t%8s\n" : "\n", "baseline", "change");
+
+    for (e = 0; e < nengines; e++)
+    {
+        for (p = 0; p < SYNTH_PATTERNS; p++)
+        {
+            struct BenchResult result;
+            long rss = 0;
+            double ns;
+            int ok = 1;
+            int r;
+
+            memset(&result, 0, sizeof(result));
+            pattern.pattern = (enum SynthPattern) p;
+            for (r = 0; r < repeats && ok; r++)
+            {
+                struct BenchResult repeat;
+                long repeatRss = 0;
+
+                ok = benchFork(&engines[e], &pattern, count, &repeat, &repeatRss) == 0 && repeat.accesses > 0;
+                if (ok && (r == 0 || repeat.seconds < result.seconds))
+                {
+                    result = repeat;
+                }
+                rss = repeatRss > rss ? repeatRss : rss;
+            }
+            if (!ok)
+            {
+                printf("%-12s\t%-10s\tfailed\n", engines[e].name, synthNames[p]);
+                failures++;
+                continue;
+            }
+            ns = result.seconds * 1e9 / result.accesses;
+            printf("%-12s\t%-10s\t%12.0f\t%10.2f\t%10ld\t%10f", engines[e].name, synthNames[p],
+                   result.accesses / result.seconds, ns, rss, (double) result.misses / result.accesses);
+            if (save != NULL)
+            {
+                fprintf(save, "%s %s %f %ld\n", engines[e].name, synthNames[p], ns, rss);
+            }
+            if (compareName != NULL)
+            {
+                for (i = 0; i < baselines; i++)
+                {
+                    if (strcmp(baseline[i].engine, engines[e].name) == 0 &&
+                        strcmp(baseline[i].pattern, synthNames[p]) == 0)
+                    {
+                        double change = ns / baseline[i].ns - 1.0;
+
+                        printf("\t%10.2f\t%+7.1f%%%s", baseline[i].ns, 100.0 * change,
+                               change > tolerance ? "\tREGRESSED" : "");
+                        regressions += change > tolerance;
+                        break;
+                    }
+                }
+            }
+            printf("\n");
+        }
+    }
+
+    if (save != NULL && fclose(save) != 0)
+    {
+        perror("Could not write the baseline");
+        exit(EXIT_FAILURE);
+    }
+    free(baseline);
+    if (regressions > 0)
+    {
+        printf("%d runs are more than %g%% slower than the baseline\n", regressions, 100.0 * tolerance);
+    }
+    return regressions > 0 || failures > 0 ? EXIT_FAILURE : 0;
+}
@@ -0,0 +1,38 @@
+/*cacheline.h
+  Packed state of one simulated cache line: the valid and dirty bits live in the top 2 bits of a 64-bit word,
+  and the remaining 62 bits hold the tag (direct-mapped cache) or the time of last use (k-way cache).
+  A tag is at most 64 - offset_size bits, and blocks are at least 4 bytes, so it always fits.
+  */
+
+#ifndef CACHELINE_H
+#define CACHELINE_H
+
+#include <stdint.h>
+
+#define LINE_VALID ((uint64_t) 1 << 63)
+#define LINE_DIRTY ((uint64_t) 1 << 62)
+#define LINE_BITS (LINE_DIRTY - 1)
+
+static inline int lineValid(uint64_t line)
+{
+    return (line & LINE_VALID) != 0;
+}
+
+static inline int lineDirty(uint64_t line)
+{
+    return (line & LINE_DIRTY) != 0;
+}
+
+/*The tag or time of last use*/
+static inline uint64_t lineBits(uint64_t line)
+{
+    return line & LINE_BITS;
+}
+
+/*A valid line holding bits*/
+static inline uint64_t lineMake(uint64_t bits, int dirty)
+{
+    return bits | LINE_VALID | (dirty ? LINE_DIRTY : 0);
+}
+
+#endif
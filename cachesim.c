@@ -0,0 +1,1173 @@
+/*cachesim.c
+  Cache models, see cachesim.h.
+  Both kinds of cache keep their sets in one allocation of packed lines (see cacheline.h). A k-way set is
+  looked up with the tag match kernels of tagmatch.h, by a kernel specialized for the common set-associativities
+  and the instruction set of the CPU, and a single LRU set through the hash index of fullassoc.c. The statistics
+  of every access go to the CacheStats given with it, and what the last access did to cache->last, for the verbose
+  output of the command line tools.
+  */
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cachesim.h"
+#include "cacheline.h"
+#include "tagmatch.h"
+
+static void directSelect(struct Cache* cache);
+static void kwaySelect(struct Cache* cache);
+
+/*Set up an empty cache as configured. Returns 0, or -1 with *error set to why the configuration is not valid*/
+int cacheInit(struct Cache* cache, const struct CacheConfig* config, const char** error)
+{
+    int k = config->kind == CACHE_DIRECT ? 1 : config->k;
+    int blockSize = config->blockSize != 0 ? config->blockSize : CACHE_BLOCK_SIZE;
+
+    memset(cache, 0, sizeof(*cache));
+    cache->kind = config->kind;
+    cache->input_cachesize = config->cachesize;
+    cache->last.caseNum = CASE_NONE;
+    if (config->kind == CACHE_DIRECT)
+    {
+        cache->last.cTag = (uint64_t) -1;
+        cache->last.dbit = -1;
+        cache->last.hitOrMiss = -1;
+    }
+
+    if (ceil(1024 * config->cachesize) == 1024 * config->cachesize &&
+        floor(1024 * config->cachesize) == 1024 * config->cachesize)
+    {
+        /*If the cachesize, represented in bytes, is an integer, then it can be converted to an int.*/
+        cache->cachesize = (int) 1024 * config->cachesize;
+    }
+    else
+    {
+        *error = "cachesize*1024 must be an integer";
+        return -1;
+    }
+
+    /*At least 4 bytes, so that a tag leaves room for the valid and dirty bits of its line (see cacheline.h)*/
+    if (blockSize < 4 || (blockSize & (blockSize - 1)) != 0)
+    {
+        *error = "The block size must be a power of 2 of at least 4 bytes";
+        return -1;
+    }
+    cache->blockSize = blockSize;
+
+    if (k == FULLY_ASSOCIATIVE && cache->cachesize >= 2 * blockSize)
+    {
+        k = cache->cachesize / blockSize;
+    }
+    if (k == 0)
+    {
+        *error = "A problem occurred when reading the set-associativity";
+        return -1;
+    }
+    else if (config->kind == CACHE_KWAY && k < 2)
+    {
+        *error = "k must be >= 2";
+        return -1;
+    }
+    cache->k = k;
+
+    /*Cache size minimum: k blocks*/
+    if (cache->cachesize % 2 != 0 || cache->cachesize < (k * blockSize))
+    {
+        *error = "cachesize must be a power of 2 bytes. If it is,"
+                 "then the crash may have occurred because the cache size must be at least 2^-6 = 0.015625";
+        return -1;
+    }
+
+    cache->sets = cache->cachesize / (k * blockSize);
+    cache->offset_size = __builtin_ctz((unsigned int) blockSize);
+    cache->index_size = (int) log2((double) cache->sets); /*sets is guaranteed to be a power of 2, so this is safe*/
+    cache->tag_size = 64 - cache->index_size - cache->offset_size;
+
+    if (config->kind == CACHE_DIRECT)
+    {
+        /*One line per set, all invalid*/
+        cache->lines = calloc((size_t) cache->sets, sizeof(*cache->lines));
+        if (cache->lines == NULL)
+        {
+            *error = "Could not allocate the cache";
+            return -1;
+        }
+        directSelect(cache);
+        return 0;
+    }
+
+    /*A single LRU set is looked up through a hash table instead of by comparing every tag*/
+    if (cache->sets == 1 && config->policy != NULL && strcmp(config->policy->name, "lru") == 0)
+    {
+        cache->full = malloc(sizeof(*cache->full));
+        if (cache->full == NULL || fullInit(cache->full, k) != 0)
+        {
+            free(cache->full);
+            cache->full = NULL;
+            *error = "Could not allocate the cache";
+            return -1;
+        }
+        kwaySelect(cache);
+        return 0;
+    }
+
+    if (config->policy != NULL && config->policy->powerOf2 && (k & (k - 1)) != 0)
+    {
+        *error = "The replacement policy needs k to be a power of 2";
+        return -1;
+    }
+    if (config->policy != NULL && config->policy->maxK != 0 && k > config->policy->maxK)
+    {
+        *error = "The replacement policy supports at most 65536 ways per set with more than 1 set";
+        return -1;
+    }
+
+    /*k tags and k lines per set, all invalid*/
+    cache->lines = calloc((size_t) cache->sets * 2 * k, sizeof(*cache->lines));
+    if (cache->lines == NULL)
+    {
+        *error = "Could not allocate the cache";
+        return -1;
+    }
+
+    if (config->policy != NULL)
+    {
+        size_t i;
+
+        cache->policy = config->policy;
+        cache->policyStride = policyStride(config->policy, k);
+        cache->policyState = malloc((size_t) cache->sets * cache->policyStride);
+        if (cache->policyState == NULL && cache->policyStride > 0)
+        {
+            cacheFree(cache);
+            *error = "Could not allocate the replacement policy state";
+            return -1;
+        }
+        for (i = 0; i < (size_t) cache->sets; i++)
+        {
+            config->policy->init(cache->policyState + i * cache->policyStride, k);
+        }
+    }
+    kwaySelect(cache);
+    return 0;
+}
+
+/*Simulate one load (Ld_St = 'L') or store (Ld_St = 'S') of address MEM, order is the # of the access*/
+void cacheAccess(struct Cache* cache, char Ld_St, uint64_t MEM, int64_t order, struct CacheStats* stats)
+{
+    cache->access(cache, Ld_St, MEM, order, stats);
+}
+
+/*Simulate n records of a trace, the first of which is access # first*/
+void cacheSimulateBatch(struct Cache* cache, const struct TraceRecord* records, size_t n, int64_t first,
+                        struct CacheStats* stats)
+{
+    cache->batch(cache, records, n, first, stats);
+}
+
+void cacheStatsAdd(struct CacheStats* total, const struct CacheStats* part)
+{
+    total->dataAccesses += part->dataAccesses;
+    total->dataReads += part->dataReads;
+    total->dataWrites += part->dataWrites;
+    total->dataMisses += part->dataMisses;
+    total->readMisses += part->readMisses;
+    total->writeMisses += part->writeMisses;
+    total->dReadMisses += part->dReadMisses;
+    total->dWriteMisses += part->dWriteMisses;
+    total->bytesRead += part->bytesRead;
+    total->bytesWritten += part->bytesWritten;
+    total->readCycles += part->readCycles;
+    total->writeCycles += part->writeCycles;
+}
+
+/*Copy bytes at data to state (save) or back (load), advancing *pos. Only counts them if state is NULL*/
+static void stateCopy(unsigned char* state, size_t* pos, void* data, size_t bytes, int save)
+{
+    if (state != NULL && bytes > 0)
+    {
+        if (save)
+        {
+            memcpy(state + *pos, data, bytes);
+        }
+        else
+        {
+            memcpy(data, state + *pos, bytes);
+        }
+    }
+    *pos += (bytes + 7) / 8 * 8;
+}
+
+/*The statistics, then the lines and policy state, or the lines, recency list and hash table of a fully
+ * associative cache. Returns the size of the state*/
+static size_t cacheState(struct Cache* cache, struct CacheStats* stats, unsigned char* state, int save)
+{
+    size_t pos = 0;
+
+    stateCopy(state, &pos, stats, sizeof(*stats), save);
+    if (cache->full != NULL)
+    {
+        struct FullCache* full = cache->full;
+        size_t size = (size_t) full->size;
+
+        stateCopy(state, &pos, &full->used, sizeof(full->used), save);
+        stateCopy(state, &pos, &full->head, sizeof(full->head), save);
+        stateCopy(state, &pos, &full->tail, sizeof(full->tail), save);
+        stateCopy(state, &pos, full->prev, size * sizeof(*full->prev), save);
+        stateCopy(state, &pos, full->next, size * sizeof(*full->next), save);
+        stateCopy(state, &pos, full->blocks, size * sizeof(*full->blocks), save);
+        stateCopy(state, &pos, full->lines, size * sizeof(*full->lines), save);
+        stateCopy(state, &pos, full->table, (size_t) (full->mask + 1) * sizeof(*full->table), save);
+        return pos;
+    }
+    stateCopy(state, &pos, cache->lines,
+              (size_t) cache->sets * (cache->kind == CACHE_DIRECT ? 1 : 2 * (size_t) cache->k) * sizeof(*cache->lines),
+              save);
+    stateCopy(state, &pos, cache->policyState, (size_t) cache->sets * cache->policyStride, save);
+    return pos;
+}
+
+/*# of bytes cacheSave writes, a multiple of 8*/
+size_t cacheStateSize(const struct Cache* cache)
+{
+    return cacheState((struct Cache*) cache, NULL, NULL, 1);
+}
+
+/*Copy the blocks and replacement state of cache and stats into state, cacheStateSize bytes*/
+void cacheSave(const struct Cache* cache, const struct CacheStats* stats, void* state)
+{
+    cacheState((struct Cache*) cache, (struct CacheStats*) stats, state, 1);
+}
+
+/*Put cache and stats back as cacheSave found them. cache must have the configuration it had then*/
+void cacheLoad(struct Cache* cache, struct CacheStats* stats, const void* state)
+{
+    cacheState(cache, stats, (unsigned char*) state, 0);
+}
+
+void cacheFree(struct Cache* cache)
+{
+    if (cache->full != NULL)
+    {
+        fullFree(cache->full);
+        free(cache->full);
+        cache->full = NULL;
+    }
+    free(cache->lines);
+    free(cache->policyState);
+    cache->lines = NULL;
+    cache->policyState = NULL;
+}
+
+/*Direct-mapped cache: simulate one load (Ld_St = 'L') or store (Ld_St = 'S') of address MEM*/
+static void directAccess(struct Cache* cache, char Ld_St, uint64_t MEM, int64_t order, struct CacheStats* stats)
+{
+    uint64_t* line;
+    uint64_t Index;
+    uint64_t tag;
+
+    (void) order; /*A direct-mapped cache has no replacement to order*/
+
+    /*Index = the index_size bits above the offset. A mask instead of shifting the tag out, which would
+     * shift by 64 bits when the cache has a single row*/
+    Index = (MEM >> cache->offset_size) & (((uint64_t) 1 << cache->index_size) - 1);
+    tag = MEM >> (cache->index_size + cache->offset_size);
+    line = &cache->lines[Index];
+
+    cache->last.Index = Index;
+    cache->last.tag = tag;
+    cache->last.dbit = lineDirty(*line);
+    cache->last.cTag = lineBits(*line);
+    cache->last.valid = lineValid(*line);
+
+    if(Ld_St=='L')
+    {
+        /*Case 1: the block containing A is found in data cache (cache hit)*/
+        /*Read: no state changes, 1 cycle*/
+        if(lineValid(*line) && tag==lineBits(*line))
+        {
+            stats->readCycles += 1;
+            cache->last.hitOrMiss = 1;
+            cache->last.caseNum = CASE_HIT;
+        }
+        /*Case 2a: Clean cache miss, Read*/
+        else if(!lineDirty(*line) || !lineValid(*line))
+        {
+            /*Read, move block containing A from MEM into Index I in data cache*/
+            *line = lineMake(tag, 0);
+
+            stats->bytesRead += cache->blockSize;
+            stats->readCycles += (1 + CACHE_MISS_PENALTY);
+            stats->readMisses++;
+            stats->dataMisses++;
+            stats->dReadMisses++;
+            cache->last.hitOrMiss = 0;
+            cache->last.caseNum = CASE_CLEAN_MISS;
+        }
+        /*Case 2b: Dirty cache miss, Read*/
+        else if(lineValid(*line) && tag != lineBits(*line) && lineDirty(*line))
+        {
+            /*Read: write block X to memory, move block containing A from memory into data cache.*/
+            *line = lineMake(tag, 0);
+
+            stats->bytesWritten += cache->blockSize;
+            stats->bytesRead += cache->blockSize;
+            stats->readMisses++;
+            stats->dataMisses++;
+            stats->readCycles += (1 + 2*CACHE_MISS_PENALTY);
+            stats->dReadMisses++;
+            cache->last.hitOrMiss = 0;
+            cache->last.caseNum = CASE_DIRTY_MISS;
+        }
+
+        *line &= ~LINE_DIRTY;
+        stats->dataReads++;
+    }
+    else if(Ld_St=='S')
+    {
+        /*Case 1: Cache hit, Write*/
+        if(lineValid(*line) && tag==lineBits(*line))
+        {
+            *line = lineMake(tag, 1);
+
+            stats->bytesWritten += cache->blockSize;
+            stats->writeCycles += 1;
+            cache->last.hitOrMiss = 1;
+            cache->last.caseNum = CASE_HIT;
+        }
+        /*Case 2a: Clean cache miss, Write*/
+        else if( (tag!=lineBits(*line) && !lineDirty(*line))
+                || (!lineValid(*line)) )
+        {
+            /*Write: move block containing A from memory into Index I data cache, dirty bit = 1*/
+            *line = lineMake(tag, 1);
+
+            stats->bytesRead += cache->blockSize;
+            stats->writeCycles += (1 + CACHE_MISS_PENALTY);
+            stats->writeMisses++;
+            stats->dataMisses++;
+            stats->dWriteMisses++;
+            cache->last.hitOrMiss = 0;
+            cache->last.caseNum = CASE_CLEAN_MISS;
+        }
+        /*Case 2b: Dirty cache miss, write*/
+        else if(lineDirty(*line) && lineValid(*line) && tag!=lineBits(*line))
+        {
+            /*Write: write block X to memory move block containing A from memory into data cache*/
+            *line = lineMake(tag, 1);
+
+            stats->bytesRead += cache->blockSize;
+            stats->bytesWritten += cache->blockSize;
+            stats->writeCycles += (1 + 2*CACHE_MISS_PENALTY);
+            stats->writeMisses++;
+            stats->dataMisses++;
+            stats->dWriteMisses++;
+            cache->last.hitOrMiss = 0;
+            cache->last.caseNum = CASE_DIRTY_MISS;
+        }
+
+        stats->dataWrites++;
+    } /*End of Store*/
+
+    stats->dataAccesses++;
+}
+
+static void directChunk(struct Cache* cache, const struct TraceRecord* records, size_t n, int64_t first,
+                        struct CacheStats* stats)
+{
+    size_t j;
+
+    for (j = 0; j < n; j++)
+    {
+        directAccess(cache, traceOp(&records[j]), records[j].mem, first + (int64_t) j, stats);
+    }
+}
+
+static void directSelect(struct Cache* cache)
+{
+    cache->access = directAccess;
+    cache->batch = directChunk;
+}
+
+#define KWAY_DISPATCH TAGMATCH_ISAS /*Compare through tagMatch, off the access loop*/
+
+/*Returns the first valid block of the set holding tag, or -1, and sets *empty to its first invalid block, or -1.
+ * A constant isa inlines its tag match kernel, which a caller built for that instruction set can unroll for k*/
+static inline __attribute__((always_inline))
+int kwayLookup(const uint64_t* tags, const uint64_t* meta, int k, uint64_t tag, int* empty, const int isa)
+{
+    uint64_t hit;
+    uint64_t invalid;
+    int base;
+    int n;
+
+    *empty = -1;
+    for (base = 0; base < k; base += TAGMATCH_WAYS)
+    {
+        n = k - base < TAGMATCH_WAYS ? k - base : TAGMATCH_WAYS;
+        switch (isa)
+        {
+#ifdef TAGMATCH_X86
+            case TAGMATCH_AVX2:
+                hit = tagMatchAvx2(tags + base, meta + base, n, tag, &invalid);
+                break;
+            case TAGMATCH_SSE41:
+                hit = tagMatchSse41(tags + base, meta + base, n, tag, &invalid);
+                break;
+#endif
+            case TAGMATCH_SCALAR:
+                hit = tagMatchScalar(tags + base, meta + base, n, tag, &invalid);
+                break;
+            default:
+                hit = tagMatch(tags + base, meta + base, n, tag, &invalid);
+                break;
+        }
+        if (*empty == -1 && invalid != 0)
+        {
+            *empty = base + __builtin_ctzll(invalid);
+        }
+        if (hit != 0)
+        {
+            return base + __builtin_ctzll(hit);
+        }
+    }
+    return -1;
+}
+
+/*Count one access that hit, or else missed and evicted a block that was dirty or not*/
+static inline __attribute__((always_inline))
+void kwayCount(struct Cache* cache, int write, int hit, int dirty, struct CacheStats* stats)
+{
+    if (hit)
+    {
+        cache->last.caseNum = CASE_HIT;
+        cache->last.hitOrMiss = 1;
+        if (write)
+        {
+            stats->writeCycles += 1;
+        }
+        else
+        {
+            stats->readCycles += 1;
+        }
+    }
+    else
+    {
+        cache->last.caseNum = dirty ? CASE_DIRTY_MISS : CASE_CLEAN_MISS;
+        cache->last.hitOrMiss = 0;
+        stats->bytesRead += cache->blockSize;
+        stats->dataMisses++;
+        if (dirty)
+        {
+            stats->bytesWritten += cache->blockSize;
+        }
+        if (write)
+        {
+            stats->writeCycles += dirty ? 1 + 2 * CACHE_MISS_PENALTY : 1 + CACHE_MISS_PENALTY;
+            stats->writeMisses++;
+            stats->dWriteMisses += dirty;
+        }
+        else
+        {
+            stats->readCycles += dirty ? 1 + 2 * CACHE_MISS_PENALTY : 1 + CACHE_MISS_PENALTY;
+            stats->readMisses++;
+            stats->dReadMisses += dirty;
+        }
+    }
+
+    if (write)
+    {
+        stats->dataWrites++;
+    }
+    else
+    {
+        stats->dataReads++;
+    }
+    stats->dataAccesses++;
+}
+
+/*Simulate one access to set Index with cache->policy choosing the victims.
+ * A miss fills the first empty block, or else evicts the victim, writing it back first if it is dirty*/
+static inline __attribute__((always_inline))
+void kwayReplace(struct Cache* cache, char Ld_St, uint64_t Index, uint64_t tag, uint64_t* tags, uint64_t* meta,
+                 int64_t order, const int k, int hitBlock, int emptyBlock, struct CacheStats* stats)
+{
+    void* state = cache->policyState + Index * cache->policyStride;
+    int dirty;
+    int write = Ld_St == 'S';
+    int way;
+
+    way = hitBlock;
+    if (way == -1)
+    {
+        way = emptyBlock != -1 ? emptyBlock : cache->policy->victim(state, k, policySeed(Index, order));
+    }
+    dirty = lineValid(meta[way]) && lineDirty(meta[way]);
+
+    cache->last.dbit = lineDirty(meta[way]); /*for verbose mode*/
+    cache->last.lastUsed = lineBits(meta[way]); /*for verbose mode*/
+    cache->last.chosenBlock = way; /*for verbose mode*/
+    cache->last.cTag = tags[way]; /*for verbose mode*/
+    cache->last.valid = lineValid(meta[way]); /*for verbose mode*/
+
+    if (hitBlock != -1)
+    {
+        cache->policy->touch(state, k, way);
+        meta[way] = lineMake((uint64_t) order, dirty || write);
+    }
+    else
+    {
+        tags[way] = tag;
+        meta[way] = lineMake((uint64_t) order, write);
+        cache->policy->insert(state, k, way, policySeed(Index, order));
+    }
+    kwayCount(cache, write, hitBlock != -1, dirty, stats);
+}
+
+/*Simulate one load (Ld_St = 'L') or store (Ld_St = 'S') of address MEM, order is the # of the access.
+ * Always inlined, so that a constant k unrolls the loops over the set and makes its offsets constant,
+ * and a constant isa picks the tag match kernel*/
+static inline __attribute__((always_inline))
+void kwayAccessWays(struct Cache* cache, char Ld_St, uint64_t MEM, int64_t order, struct CacheStats* stats, const int k,
+                    const int isa)
+{
+    uint64_t* meta;
+    uint64_t* tags;
+    int caseCompleted = 0;
+    int emptyBlock; /*The first invalid block of the set, or -1*/
+    int firstEmptyBlock = -1;
+    int foundAddress = 0;
+    int foundPair;
+    int hitBlock; /*The block holding tag, or -1*/
+    int i;
+    int minIndex;
+    int selectedBlock = -1; /*The block # of the given block, selected within the given set of the cache*/
+    uint64_t Index;
+    uint64_t tag;
+
+
+    /*Index = the index_size bits above the offset. A mask instead of shifting the tag out, which would
+     * shift by 64 bits when there is a single set*/
+    Index = (MEM >> cache->offset_size) & (((uint64_t) 1 << cache->index_size) - 1);
+    tag = MEM >> (cache->index_size + cache->offset_size);
+    tags = cache->lines + 2 * (size_t) k * Index;
+    meta = tags + k;
+    hitBlock = kwayLookup(tags, meta, k, tag, &emptyBlock, isa);
+
+    cache->last.Index = Index;
+    cache->last.tag = tag;
+    cache->last.caseNum = CASE_NONE;
+    cache->last.dbit = 0;
+
+    if (cache->policy != NULL)
+    {
+        kwayReplace(cache, Ld_St, Index, tag, tags, meta, order, k, hitBlock, emptyBlock, stats);
+        return;
+    }
+
+    /*Legacy victim search*/
+    if (Ld_St == 'L')
+    {
+        /*Case 1: Hit, read*/
+        if (hitBlock != -1)
+        {
+            selectedBlock = hitBlock;
+            foundAddress = 1;
+        }
+        /*the block containing A is found in index I id D in the data cache*/
+        if (foundAddress)
+        {
+            cache->last.dbit = lineDirty(meta[selectedBlock]); /*for verbose mode*/
+            cache->last.lastUsed = lineBits(meta[selectedBlock]); /*for verbose mode*/
+            cache->last.chosenBlock = selectedBlock; /*for verbose mode*/
+            cache->last.cTag = tags[selectedBlock]; /*for verbose mode*/
+            cache->last.valid = lineValid(meta[selectedBlock]); /*for verbose mode*/
+            caseCompleted = 1;
+            cache->last.caseNum = CASE_HIT;
+            meta[selectedBlock] = lineMake((uint64_t) order, lineDirty(meta[selectedBlock]));
+            stats->readCycles += 1;
+            cache->last.hitOrMiss = 1;
+        }
+
+
+        /*Case 2a: Clean miss, read*/
+        if (!caseCompleted)
+        {
+            if (emptyBlock != -1)
+            {
+                firstEmptyBlock = emptyBlock;
+                cache->last.dbit = lineDirty(meta[firstEmptyBlock]); /*for verbose mode*/
+                cache->last.lastUsed = lineBits(meta[firstEmptyBlock]); /*for verbose mode*/
+                cache->last.chosenBlock = firstEmptyBlock; /*for verbose mode*/
+                cache->last.cTag = tags[firstEmptyBlock]; /*for verbose mode*/
+                cache->last.valid = lineValid(meta[firstEmptyBlock]); /*for verbose mode*/
+                tags[firstEmptyBlock] = tag;
+                meta[firstEmptyBlock] = lineMake((uint64_t) order, 0);
+                stats->readCycles += (1 + CACHE_MISS_PENALTY);
+                stats->bytesRead += cache->blockSize;
+                cache->last.caseNum = CASE_CLEAN_MISS;
+                caseCompleted = 1;
+                cache->last.hitOrMiss = 0;
+                stats->readMisses++;
+                stats->dataMisses++;
+            }
+        }
+        /*Case 2a: clean miss, read*/
+        /*Since no empty blocks were found, replace the block with the smallest LU*/
+        if (firstEmptyBlock == -1 && !caseCompleted)
+        {
+            foundPair = 0;
+            minIndex = 0;
+            for (i = 0; i < (k - 1); i++)
+            {
+                if (tag != tags[minIndex] && !lineDirty(meta[minIndex]) &&
+                    lineValid(meta[minIndex]))
+                {
+                    if (tag != tags[i + 1] && !lineDirty(meta[i + 1])
+                        && lineValid(meta[i + 1]))
+                    {
+                        foundPair = 1;
+
+                        /*Compare block k and block k+1 in pairs, for all possible pairs,
+                         * in order to find the block with the smallest LU value*/
+                        if (lineBits(meta[minIndex]) <= lineBits(meta[i+1]))
+                        {
+                            continue;
+                        }
+                        else if (lineBits(meta[i]) > lineBits(meta[i]))
+                        {
+                            minIndex = i + 1;
+                        }
+                    }
+                }
+            }
+            selectedBlock = minIndex;
+            /*If a clean miss occurred*/
+            if(foundPair)
+            {
+                cache->last.dbit = lineDirty(meta[selectedBlock]); /*for verbose mode*/
+                cache->last.lastUsed = lineBits(meta[selectedBlock]); /*for verbose mode*/
+                cache->last.chosenBlock = selectedBlock; /*for verbose mode*/
+                cache->last.cTag = tags[selectedBlock]; /*for verbose mode*/
+                cache->last.valid = lineValid(meta[selectedBlock]); /*for verbose mode*/
+                tags[selectedBlock] = tag;
+                meta[selectedBlock] = lineMake((uint64_t) order, 0);
+                stats->readCycles += (1 + CACHE_MISS_PENALTY);
+                stats->bytesRead += cache->blockSize;
+                caseCompleted = 1;
+                cache->last.caseNum = CASE_CLEAN_MISS;
+                cache->last.hitOrMiss = 0;
+                stats->readMisses++;
+                stats->dataMisses++;
+            }
+        }
+
+
+        /*Case 2b: Dirty miss, read*/
+        /*It is assumed that there is only 1 hit/miss per scanned line, even if both
+        * dirty and a clean misses occur within the same set of blocks, all matched
+         * to the same tag*/
+        if (!caseCompleted)
+        {
+            foundPair = 0;
+            minIndex = 0;
+            for (i = 0; i < k - 1; i++)
+            {
+                if (tag != tags[minIndex] && lineDirty(meta[minIndex]) &&
+                    lineValid(meta[minIndex]))
+                {
+
+                    if (tag != tags[i + 1] && !lineDirty(meta[i + 1]) &&
+                        lineValid(meta[i + 1]))
+                    {
+                        foundPair = 1;
+                        if (lineBits(meta[minIndex]) <= lineBits(meta[i+1]))
+                        {
+                            continue;
+                        }
+                        else if (lineBits(meta[i]) > lineBits(meta[i]))
+                        {
+                            minIndex = i + 1;
+                        }
+                    }
+                }
+            }
+            selectedBlock = minIndex;
+            if(selectedBlock != -1)
+            {
+                cache->last.dbit = lineDirty(meta[selectedBlock]); /*for verbose mode*/
+                cache->last.lastUsed = lineBits(meta[selectedBlock]); /*for verbose mode*/
+                cache->last.chosenBlock = selectedBlock; /*for verbose mode*/
+                cache->last.cTag = tags[selectedBlock]; /*for verbose mode*/
+                cache->last.valid = lineValid(meta[selectedBlock]); /*for verbose mode*/
+                tags[selectedBlock] = tag;
+                meta[selectedBlock] = lineMake((uint64_t) order, 0);
+                stats->readCycles += (1 + 2 * CACHE_MISS_PENALTY);
+                stats->bytesRead += cache->blockSize;
+                stats->bytesWritten += cache->blockSize;
+                caseCompleted = 1;
+                cache->last.caseNum = CASE_DIRTY_MISS;
+                cache->last.hitOrMiss = 0;
+                stats->dReadMisses++;
+                stats->readMisses++;
+                stats->dataMisses++;
+            }
+
+        }
+
+        stats->dataReads++;
+    } /*end of load*/
+    else if (Ld_St == 'S')
+    {
+        /*Case 1: Hit, write*/
+        if (hitBlock != -1)
+        {
+            selectedBlock = hitBlock;
+            foundAddress = 1;
+            caseCompleted = 1;
+        }
+        /*the block containing A is found in index I id D in the data cache*/
+        if (foundAddress)
+        {
+            cache->last.dbit = lineDirty(meta[selectedBlock]); /*for verbose mode*/
+            cache->last.lastUsed = lineBits(meta[selectedBlock]); /*for verbose mode*/
+            cache->last.chosenBlock = selectedBlock; /*for verbose mode*/
+            cache->last.cTag = tags[selectedBlock]; /*for verbose mode*/
+            cache->last.valid = lineValid(meta[selectedBlock]); /*for verbose mode*/
+            cache->last.caseNum = CASE_HIT;
+            meta[selectedBlock] = lineMake((uint64_t) order, 1);
+            stats->writeCycles += 1;
+            cache->last.hitOrMiss = 1;
+        }
+
+        /*Case 2a: Clean miss, write*/
+        if (!caseCompleted)
+        {
+            /*Look for an empty block to fetch the address from MEM into*/
+            if (emptyBlock != -1)
+            {
+                firstEmptyBlock = emptyBlock;
+                cache->last.dbit = lineDirty(meta[firstEmptyBlock]); /*for verbose mode*/
+                cache->last.lastUsed = lineBits(meta[firstEmptyBlock]); /*for verbose mode*/
+                cache->last.chosenBlock = firstEmptyBlock; /*for verbose mode*/
+                cache->last.cTag = tags[firstEmptyBlock]; /*for verbose mode*/
+                cache->last.valid = lineValid(meta[firstEmptyBlock]); /*for verbose mode*/
+                tags[firstEmptyBlock] = tag;
+                meta[firstEmptyBlock] = lineMake((uint64_t) order, 1);
+                stats->writeCycles += (1 + CACHE_MISS_PENALTY);
+                stats->bytesWritten += cache->blockSize;
+                cache->last.caseNum = CASE_CLEAN_MISS;
+                caseCompleted = 1;
+                cache->last.hitOrMiss = 0;
+                stats->writeMisses++;
+                stats->dataMisses++;
+            }
+        }
+
+        /*If there were no empty blocks, replace the block with the smallest LU value*/
+        if (firstEmptyBlock == -1 && !caseCompleted)
+        {
+            foundPair = 0;
+            minIndex = 0;
+            for (i = 0; i < (k - 1); i++)
+            {
+                if (tag != tags[minIndex] && !lineDirty(meta[minIndex]) &&
+                    lineValid(meta[minIndex]))
+                {
+                    if (tag != tags[i + 1] && !lineDirty(meta[i + 1])
+                        && lineValid(meta[i + 1]))
+                    {
+                        foundPair = 1;
+                        if (lineBits(meta[minIndex]) <= lineBits(meta[i+1]))
+                        {
+                            continue;
+                        }
+                        else if (lineBits(meta[i]) > lineBits(meta[i]))
+                        {
+                            minIndex = i + 1;
+                        }
+                    }
+                }
+            }
+            selectedBlock = minIndex;
+            if(foundPair)
+            {
+                cache->last.dbit = lineDirty(meta[selectedBlock]); /*for verbose mode*/
+                cache->last.lastUsed = lineBits(meta[selectedBlock]); /*for verbose mode*/
+                cache->last.chosenBlock = selectedBlock; /*for verbose mode*/
+                cache->last.cTag = tags[selectedBlock]; /*for verbose mode*/
+                cache->last.valid = lineValid(meta[selectedBlock]); /*for verbose mode*/
+                tags[selectedBlock] = tag;
+                meta[selectedBlock] = lineMake((uint64_t) order, 1);
+                stats->writeCycles += (1 + CACHE_MISS_PENALTY);
+                stats->bytesWritten += cache->blockSize;
+                caseCompleted = 1;
+                cache->last.caseNum = CASE_CLEAN_MISS;
+                cache->last.hitOrMiss = 0;
+                stats->writeMisses++;
+                stats->dataMisses++;
+            }
+        }
+
+        /*Case 2b: Dirty miss, write*/
+        /*Replace the block with the smallest LU value*/
+        if (!caseCompleted)
+        {
+            foundPair = 0;
+            minIndex = 0;
+            for (i = 0; i < k - 1; i++)
+            {
+                if (tag != tags[minIndex] && lineDirty(meta[minIndex]) &&
+                    lineValid(meta[minIndex]))
+                {
+                    if (tag != tags[i + 1] && !lineDirty(meta[i + 1])
+                        && lineValid(meta[i + 1]))
+                    {
+                        foundPair = 1;
+                        if (lineBits(meta[minIndex]) <= lineBits(meta[i+1]))
+                        {
+                            continue;
+                        }
+                        else if (lineBits(meta[i]) > lineBits(meta[i]))
+                        {
+                            minIndex = i + 1;
+                        }
+                    }
+                }
+            }
+            selectedBlock = minIndex;
+            if(foundPair)
+            {
+                cache->last.dbit = lineDirty(meta[selectedBlock]); /*for verbose mode*/
+                cache->last.lastUsed = lineBits(meta[selectedBlock]); /*for verbose mode*/
+                cache->last.chosenBlock = selectedBlock; /*for verbose mode*/
+                cache->last.cTag = tags[selectedBlock]; /*for verbose mode*/
+                cache->last.valid = lineValid(meta[selectedBlock]); /*for verbose mode*/
+                tags[selectedBlock] = tag;
+                meta[selectedBlock] = lineMake((uint64_t) order, 1);
+                stats->writeCycles += (1 + 2 * CACHE_MISS_PENALTY);
+                stats->bytesWritten += cache->blockSize;
+                stats->bytesRead += cache->blockSize;
+                caseCompleted = 1;
+                cache->last.caseNum = CASE_DIRTY_MISS;
+                cache->last.hitOrMiss = 0;
+                stats->dataMisses++;
+                stats->dWriteMisses++;
+                stats->writeMisses++;
+            }
+        }
+
+        stats->dataWrites++;
+    }
+
+    stats->dataAccesses++;
+}
+
+
+/*One kernel per common set-associativity and instruction set, and a generic one for any other k.
+ * kwayAccess##K##ISA simulates one access, kwayChunk##K##ISA a whole chunk of the trace without verbose output.
+ * TARGET builds them for the instruction set, so that its tag match kernel inlines into them*/
+#define KWAY_KERNEL(K, WAYS, ISA, NAME, TARGET) \
+    TARGET static void kwayAccess##K##NAME(struct Cache* cache, char Ld_St, uint64_t MEM, int64_t order, \
+                                           struct CacheStats* stats) \
+    { \
+        kwayAccessWays(cache, Ld_St, MEM, order, stats, WAYS, ISA); \
+    } \
+    TARGET static void kwayChunk##K##NAME(struct Cache* cache, const struct TraceRecord* records, size_t n, \
+                                          int64_t first, struct CacheStats* stats) \
+    { \
+        size_t j; \
+        for (j = 0; j < n; j++) \
+        { \
+            kwayAccessWays(cache, traceOp(&records[j]), records[j].mem, first + (int64_t) j, stats, WAYS, ISA); \
+        } \
+    }
+
+#define KWAY_KERNELS(ISA, NAME, TARGET) \
+    KWAY_KERNEL(2, 2, ISA, NAME, TARGET) \
+    KWAY_KERNEL(4, 4, ISA, NAME, TARGET) \
+    KWAY_KERNEL(8, 8, ISA, NAME, TARGET) \
+    KWAY_KERNEL(16, 16, ISA, NAME, TARGET) \
+    KWAY_KERNEL(32, 32, ISA, NAME, TARGET) \
+    KWAY_KERNEL(Any, cache->k, ISA, NAME, TARGET)
+
+#define KWAY_ENTRIES(NAME) \
+    { \
+        {kwayAccess2##NAME, kwayChunk2##NAME}, {kwayAccess4##NAME, kwayChunk4##NAME}, \
+        {kwayAccess8##NAME, kwayChunk8##NAME}, {kwayAccess16##NAME, kwayChunk16##NAME}, \
+        {kwayAccess32##NAME, kwayChunk32##NAME}, {kwayAccessAny##NAME, kwayChunkAny##NAME} \
+    }
+
+KWAY_KERNELS(TAGMATCH_SCALAR, Scalar, )
+#ifdef TAGMATCH_X86
+KWAY_KERNELS(TAGMATCH_SSE41, Sse41, __attribute__((target("sse4.1"))))
+KWAY_KERNELS(TAGMATCH_AVX2, Avx2, __attribute__((target("avx2"))))
+#endif
+
+#define KWAY_SPECIALIZED 5 /*Set-associativities with a kernel of their own, the generic one comes after them*/
+
+struct KwayKernel
+{
+    void (*access)(struct Cache*, char, uint64_t, int64_t, struct CacheStats*);
+    void (*batch)(struct Cache*, const struct TraceRecord*, size_t, int64_t, struct CacheStats*);
+};
+
+/*By instruction set, then set-associativity*/
+static const struct KwayKernel kwayKernels[TAGMATCH_ISAS][KWAY_SPECIALIZED + 1] =
+{
+    KWAY_ENTRIES(Scalar),
+#ifdef TAGMATCH_X86
+    KWAY_ENTRIES(Sse41),
+    KWAY_ENTRIES(Avx2),
+#endif
+};
+
+/*Fully associative LRU cache, in O(1) per access through cache->full*/
+static void kwayAccessFull(struct Cache* cache, char Ld_St, uint64_t MEM, int64_t order, struct CacheStats* stats)
+{
+    struct FullCache* full = cache->full;
+    uint64_t block = MEM >> cache->offset_size;
+    int dirty;
+    int hit;
+    int line;
+    int write = Ld_St == 'S';
+
+    line = fullFind(full, block);
+    hit = line != -1;
+    if (!hit)
+    {
+        line = fullVictim(full);
+    }
+    dirty = lineValid(full->lines[line]) && lineDirty(full->lines[line]);
+
+    cache->last.Index = 0;
+    cache->last.tag = block;
+    cache->last.dbit = lineDirty(full->lines[line]); /*for verbose mode*/
+    cache->last.lastUsed = lineBits(full->lines[line]); /*for verbose mode*/
+    cache->last.chosenBlock = line; /*for verbose mode*/
+    cache->last.cTag = full->blocks[line]; /*for verbose mode*/
+    cache->last.valid = lineValid(full->lines[line]); /*for verbose mode*/
+
+    if (hit)
+    {
+        fullTouch(full, line);
+        full->lines[line] = lineMake((uint64_t) order, dirty || write);
+    }
+    else
+    {
+        fullFill(full, line, block);
+        full->lines[line] = lineMake((uint64_t) order, write);
+    }
+    kwayCount(cache, write, hit, dirty, stats);
+}
+
+static void kwayChunkFull(struct Cache* cache, const struct TraceRecord* records, size_t n, int64_t first,
+                          struct CacheStats* stats)
+{
+    size_t j;
+
+    for (j = 0; j < n; j++)
+    {
+        kwayAccessFull(cache, traceOp(&records[j]), records[j].mem, first + (int64_t) j, stats);
+    }
+}
+
+/*Pick the kernels for cache->k and the instruction set of the CPU*/
+static void kwaySelect(struct Cache* cache)
+{
+    enum TagMatchIsa isa = tagMatchIsa();
+    const struct KwayKernel* kernel;
+
+    if (cache->full != NULL)
+    {
+        cache->access = kwayAccessFull;
+        cache->batch = kwayChunkFull;
+        return;
+    }
+    switch (cache->k)
+    {
+        case 2:
+            kernel = &kwayKernels[isa][0];
+            break;
+        case 4:
+            kernel = &kwayKernels[isa][1];
+            break;
+        case 8:
+            kernel = &kwayKernels[isa][2];
+            break;
+        case 16:
+            kernel = &kwayKernels[isa][3];
+            break;
+        case 32:
+            kernel = &kwayKernels[isa][4];
+            break;
+        default:
+            kernel = &kwayKernels[isa][KWAY_SPECIALIZED];
+            break;
+    }
+    cache->access = kernel->access;
+    cache->batch = kernel->batch;
+}
+
+/*Returns the line holding the block of MEM, numbered set * k + way, or -1. Leaves the replacement state as it is*/
+int cacheProbe(const struct Cache* cache, uint64_t MEM)
+{
+    uint64_t Index = (MEM >> cache->offset_size) & (((uint64_t) 1 << cache->index_size) - 1);
+    uint64_t tag = MEM >> (cache->index_size + cache->offset_size);
+    const uint64_t* tags;
+    int empty;
+    int way;
+
+    if (cache->full != NULL)
+    {
+        return fullFind(cache->full, MEM >> cache->offset_size);
+    }
+    if (cache->kind == CACHE_DIRECT)
+    {
+        return lineValid(cache->lines[Index]) && lineBits(cache->lines[Index]) == tag ? (int) Index : -1;
+    }
+    tags = cache->lines + 2 * (size_t) cache->k * Index;
+    way = kwayLookup(tags, tags + cache->k, cache->k, tag, &empty, KWAY_DISPATCH);
+    return way == -1 ? -1 : (int) Index * cache->k + way;
+}
+
+/*Bring the block of MEM into the cache clean, as a prefetch does, without counting an access. Returns the line it
+ * went in, with *victim set to the address of the block it evicted (UINT64_MAX if the line was empty) and *dirty to
+ * whether that one needs a write-back, or -1 if the block was already in the cache.
+ * The replacement policy picks the victim, so the legacy victim search cannot be filled this way*/
+int cacheFill(struct Cache* cache, uint64_t MEM, int64_t order, uint64_t* victim, int* dirty)
+{
+    uint64_t Index = (MEM >> cache->offset_size) & (((uint64_t) 1 << cache->index_size) - 1);
+    uint64_t tag = MEM >> (cache->index_size + cache->offset_size);
+    uint64_t* meta;
+    uint64_t* tags;
+    void* state;
+    int empty;
+    int way;
+
+    *victim = UINT64_MAX;
+    *dirty = 0;
+    if (cache->full != NULL)
+    {
+        struct FullCache* full = cache->full;
+        uint64_t block = MEM >> cache->offset_size;
+        int line;
+
+        if (fullFind(full, block) != -1)
+        {
+            return -1;
+        }
+        line = fullVictim(full);
+        if (lineValid(full->lines[line]))
+        {
+            *victim = full->blocks[line] << cache->offset_size;
+            *dirty = lineDirty(full->lines[line]);
+        }
+        fullFill(full, line, block);
+        full->lines[line] = lineMake((uint64_t) order, 0);
+        return line;
+    }
+    if (cache->kind == CACHE_DIRECT)
+    {
+        uint64_t* line = &cache->lines[Index];
+
+        if (lineValid(*line) && lineBits(*line) == tag)
+        {
+            return -1;
+        }
+        if (lineValid(*line))
+        {
+            *victim = ((lineBits(*line) << cache->index_size) | Index) << cache->offset_size;
+            *dirty = lineDirty(*line);
+        }
+        *line = lineMake(tag, 0);
+        return (int) Index;
+    }
+
+    tags = cache->lines + 2 * (size_t) cache->k * Index;
+    meta = tags + cache->k;
+    if (kwayLookup(tags, meta, cache->k, tag, &empty, KWAY_DISPATCH) != -1)
+    {
+        return -1;
+    }
+    state = cache->policyState + Index * cache->policyStride;
+    way = empty != -1 ? empty : cache->policy->victim(state, cache->k, policySeed(Index, order));
+    if (lineValid(meta[way]))
+    {
+        *victim = ((tags[way] << cache->index_size) | Index) << cache->offset_size;
+        *dirty = lineDirty(meta[way]);
+    }
+    tags[way] = tag;
+    meta[way] = lineMake((uint64_t) order, 0);
+    cache->policy->insert(state, cache->k, way, policySeed(Index, order));
+    return (int) Index * cache->k + way;
+}
+
+/*Packed state of line set * k + way of a k-way or direct-mapped cache, as cacheProbe numbers them*/
+static uint64_t* cacheLine(const struct Cache* cache, int line)
+{
+    if (cache->kind == CACHE_DIRECT)
+    {
+        return &cache->lines[line];
+    }
+    return cache->lines + 2 * (size_t) cache->k * (size_t) (line / cache->k) + cache->k + line % cache->k;
+}
+
+/*line, as cacheProbe returned it, was hit by a demand access: update its replacement state, and make it dirty if
+ * the access was a store. Counts nothing*/
+void cacheTouch(struct Cache* cache, int line, int64_t order, int write)
+{
+    uint64_t* state;
+
+    if (cache->full != NULL)
+    {
+        fullTouch(cache->full, line);
+        cache->full->lines[line] = lineMake((uint64_t) order, lineDirty(cache->full->lines[line]) || write);
+        return;
+    }
+    state = cacheLine(cache, line);
+    if (cache->kind == CACHE_DIRECT)
+    {
+        *state |= write ? LINE_DIRTY : 0;
+        return;
+    }
+    cache->policy->touch(cache->policyState + (size_t) (line / cache->k) * cache->policyStride, cache->k,
+                         line % cache->k);
+    *state = lineMake((uint64_t) order, lineDirty(*state) || write);
+}
+
+/*Make line dirty, as a write-back from the level above does, leaving its replacement state as it is*/
+void cacheSetDirty(struct Cache* cache, int line)
+{
+    if (cache->full != NULL)
+    {
+        cache->full->lines[line] |= LINE_DIRTY;
+        return;
+    }
+    *cacheLine(cache, line) |= LINE_DIRTY;
+}
+
+/*Drop the block of MEM from the cache, as a back-invalidation does. Returns -1 if it was not there, else whether it
+ * was dirty. The replacement state is left as it is, as an invalid block is filled before any victim is chosen*/
+int cacheInvalidate(struct Cache* cache, uint64_t MEM)
+{
+    int line = cacheProbe(cache, MEM);
+    uint64_t* state;
+    int dirty;
+
+    if (line == -1)
+    {
+        return -1;
+    }
+    if (cache->full != NULL)
+    {
+        dirty = lineDirty(cache->full->lines[line]);
+        fullRemove(cache->full, line);
+        return dirty;
+    }
+    state = cacheLine(cache, line);
+    dirty = lineDirty(*state);
+    *state = 0;
+    return dirty;
+}
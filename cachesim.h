@@ -0,0 +1,124 @@
+/*cachesim.h
+  The cache models of system1.c and system2.c as a library: a direct-mapped cache, and a k-way set associative
+  one with a replacement policy from policy.c, both write-back and write-allocate. Blocks are CACHE_BLOCK_SIZE bytes
+  unless configured otherwise, and every miss moves a whole block, whatever its size, in CACHE_MISS_PENALTY cycles.
+  A cache is created from a CacheConfig and simulates batches of trace records into a CacheStats the caller
+  owns. There is no global state, so any # of caches can run at once, one thread per cache, and a cache whose
+  sets are split over threads (see poolRunPartitioned) can share its lines between copies of the Cache
+  as long as every copy counts into its own CacheStats. cacheProbe and cacheFill look up and bring in a block without
+  counting an access, for the prefetchers of prefetch.c, and with cacheTouch, cacheSetDirty and cacheInvalidate make
+  up the levels of the hierarchies of hierarchy.c, which count their accesses themselves.
+  */
+
+#ifndef CACHESIM_H
+#define CACHESIM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "fullassoc.h"
+#include "policy.h"
+#include "trace.h"
+
+#define CACHE_BLOCK_SIZE 16
+#define CACHE_MISS_PENALTY 80
+#define FULLY_ASSOCIATIVE (-1) /*k given as "full": a single set of all the blocks*/
+
+enum CacheKind
+{
+    CACHE_DIRECT, /*system1.c*/
+    CACHE_KWAY /*system2.c*/
+};
+
+/*Case of the last access, which verbose mode prints as eventCases (see eventlog.h) names it*/
+enum CacheCase
+{
+    CASE_NONE, /*"NULL", before the first access*/
+    CASE_HIT, /*"1"*/
+    CASE_CLEAN_MISS, /*"2a", a miss that replaced an empty or clean block*/
+    CASE_DIRTY_MISS, /*"2b", a miss that wrote back a dirty block*/
+    CACHE_CASES
+};
+
+struct CacheConfig
+{
+    enum CacheKind kind;
+    double cachesize; /*KB, cachesize*1024 must be a power of 2*/
+    int k; /*Set-associativity of a CACHE_KWAY cache, >= 2 or FULLY_ASSOCIATIVE*/
+    const struct Policy* policy; /*Replacement of a CACHE_KWAY cache, NULL for the legacy victim search*/
+    int blockSize; /*Bytes, a power of 2 of at least 4, or 0 for CACHE_BLOCK_SIZE*/
+};
+
+struct CacheStats
+{
+    unsigned long dataAccesses;
+    unsigned long dataReads;
+    unsigned long dataWrites;
+    unsigned long dataMisses;
+    unsigned long readMisses;
+    unsigned long writeMisses;
+    unsigned long dReadMisses; /*Misses of the direct-mapped cache count here whether they were dirty or not*/
+    unsigned long dWriteMisses;
+    unsigned long bytesRead;
+    unsigned long bytesWritten;
+    unsigned long readCycles;
+    unsigned long writeCycles;
+};
+
+/*State of the last access, for verbose mode*/
+struct CacheLast
+{
+    enum CacheCase caseNum;
+    int chosenBlock;
+    int dbit;
+    int hitOrMiss;
+    int64_t lastUsed;
+    int valid;
+    uint64_t cTag;
+    uint64_t Index;
+    uint64_t tag;
+};
+
+struct Cache
+{
+    enum CacheKind kind;
+    double input_cachesize;
+    int cachesize;
+    int k; /*1 for a direct-mapped cache*/
+    int sets;
+    int blockSize;
+    int index_size;
+    int offset_size;
+    int tag_size;
+    /*All sets in one allocation. A direct-mapped set is one packed line holding its tag (see cacheline.h),
+     * a k-way set is its k tags followed by k packed lines, whose bits hold the # of the access that
+     * last used the block*/
+    uint64_t* lines;
+    /*Replacement policy and the policy state of every set, policyStride bytes each.
+     * NULL for the legacy victim search*/
+    const struct Policy* policy;
+    unsigned char* policyState;
+    size_t policyStride;
+    struct FullCache* full; /*Set for a fully associative LRU cache, which then does not use lines*/
+    /*Simulation kernels specialized for the kind of cache and k, see cacheSelect*/
+    void (*access)(struct Cache*, char, uint64_t, int64_t, struct CacheStats*);
+    void (*batch)(struct Cache*, const struct TraceRecord*, size_t, int64_t, struct CacheStats*);
+    struct CacheLast last;
+};
+
+int cacheInit(struct Cache* cache, const struct CacheConfig* config, const char** error);
+void cacheAccess(struct Cache* cache, char Ld_St, uint64_t MEM, int64_t order, struct CacheStats* stats);
+void cacheSimulateBatch(struct Cache* cache, const struct TraceRecord* records, size_t n, int64_t first,
+                        struct CacheStats* stats);
+void cacheStatsAdd(struct CacheStats* total, const struct CacheStats* part);
+size_t cacheStateSize(const struct Cache* cache);
+void cacheSave(const struct Cache* cache, const struct CacheStats* stats, void* state);
+void cacheLoad(struct Cache* cache, struct CacheStats* stats, const void* state);
+int cacheProbe(const struct Cache* cache, uint64_t MEM);
+int cacheFill(struct Cache* cache, uint64_t MEM, int64_t order, uint64_t* victim, int* dirty);
+void cacheTouch(struct Cache* cache, int line, int64_t order, int write);
+void cacheSetDirty(struct Cache* cache, int line);
+int cacheInvalidate(struct Cache* cache, uint64_t MEM);
+void cacheFree(struct Cache* cache);
+
+#endif
@@ -0,0 +1,178 @@
+/*checkpoint.c
+  Saved cache state, see checkpoint.h.
+  A checkpoint is written next to its file and renamed over it, so an interrupted save never leaves a
+  truncated checkpoint behind.
+  */
+
+#include <fcntl.h>
+#include <signal.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "checkpoint.h"
+
+static volatile sig_atomic_t interrupted = 0;
+
+/*Fill in the cache part of a header*/
+static void checkpointDescribe(struct CheckpointHeader* header, const struct Cache* cache)
+{
+    memset(header, 0, sizeof(*header));
+    memcpy(header->magic, CHECKPOINT_MAGIC, sizeof(header->magic));
+    header->version = CHECKPOINT_VERSION;
+    header->kind = (int32_t) cache->kind;
+    header->k = cache->k;
+    header->sets = cache->sets;
+    header->blockSize = cache->blockSize;
+    if (cache->policy != NULL)
+    {
+        strncpy(header->policy, cache->policy->name, sizeof(header->policy) - 1);
+    }
+    header->stateSize = cacheStateSize(cache);
+}
+
+/*Save cache and stats to filename, with order the # of the first access of trace they have not seen,
+ * which is at offset, after line. Returns -1 if it could not be written*/
+int checkpointSave(const char* filename, const struct Cache* cache, const struct CacheStats* stats,
+                   const struct TraceReader* trace, int64_t order, long long offset, int64_t line)
+{
+    struct CheckpointHeader header;
+    size_t length = strlen(filename) + 5;
+    char* temporary = malloc(length);
+    void* state;
+    FILE* out;
+    int error;
+
+    checkpointDescribe(&header, cache);
+    header.offset = offset;
+    header.order = order;
+    header.line = line;
+    header.traceLength = trace->map != NULL ? trace->mapLength : 0;
+    header.traceHash = traceFingerprint(trace);
+
+    state = malloc((size_t) header.stateSize);
+    if (temporary == NULL || state == NULL)
+    {
+        free(temporary);
+        free(state);
+        return -1;
+    }
+    snprintf(temporary, length, "%s.tmp", filename);
+    cacheSave(cache, stats, state);
+
+    out = fopen(temporary, "wb");
+    error = out == NULL;
+    if (out != NULL)
+    {
+        error = fwrite(&header, sizeof(header), 1, out) != 1 ||
+                fwrite(state, (size_t) header.stateSize, 1, out) != 1;
+        error |= fclose(out) != 0;
+    }
+    if (!error && rename(temporary, filename) != 0)
+    {
+        error = 1;
+    }
+    if (error)
+    {
+        remove(temporary);
+    }
+    free(temporary);
+    free(state);
+    return error ? -1 : 0;
+}
+
+/*Restore cache and stats from filename, and its header into header. Returns 0, -1 if it could not be read,
+ * or -2 if it was saved from a different cache*/
+int checkpointLoad(const char* filename, struct Cache* cache, struct CacheStats* stats, struct CheckpointHeader* header)
+{
+    struct CheckpointHeader expected;
+    struct stat st;
+    char* map;
+    int fd;
+
+    fd = open(filename, O_RDONLY);
+    if (fd < 0 || fstat(fd, &st) != 0 || (size_t) st.st_size < sizeof(*header))
+    {
+        if (fd >= 0)
+        {
+            close(fd);
+        }
+        return -1;
+    }
+    map = mmap(NULL, (size_t) st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+    {
+        return -1;
+    }
+
+    memcpy(header, map, sizeof(*header));
+    checkpointDescribe(&expected, cache);
+    if (memcmp(header, &expected, offsetof(struct CheckpointHeader, offset)) != 0 ||
+        (size_t) st.st_size < sizeof(*header) + (size_t) header->stateSize)
+    {
+        munmap(map, (size_t) st.st_size);
+        return -2;
+    }
+    cacheLoad(cache, stats, map + sizeof(*header));
+    munmap(map, (size_t) st.st_size);
+    return 0;
+}
+
+/*Move trace to the position a loaded checkpoint was saved at. Returns -1 if it was saved from another
+ * trace, or either trace cannot seek*/
+int checkpointResume(const struct CheckpointHeader* header, struct TraceReader* trace)
+{
+    if (header->offset < 0 || trace->map == NULL || header->traceLength != trace->mapLength ||
+        header->traceHash != traceFingerprint(trace))
+    {
+        return -1;
+    }
+    return traceSeek(trace, header->offset, header->line);
+}
+
+static void checkpointSignal(int signal)
+{
+    (void) signal;
+    interrupted = 1;
+}
+
+/*Stop the run of input before its next chunk on SIGINT or SIGTERM, remembering where in stop.
+ * A second signal ends the program as usual*/
+void checkpointCatch(struct CheckpointStop* stop, struct PoolInput* input)
+{
+    struct sigaction action;
+
+    memset(stop, 0, sizeof(*stop));
+    stop->mark = input->mark;
+    stop->markArg = input->markArg;
+    input->mark = checkpointMark;
+    input->markArg = stop;
+
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = checkpointSignal;
+    action.sa_flags = SA_RESETHAND;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+}
+
+/*The mark of a PoolInput set up by checkpointCatch*/
+int checkpointMark(void* arg, int64_t first, long long offset, int64_t line)
+{
+    struct CheckpointStop* stop = arg;
+
+    if (interrupted)
+    {
+        stop->stopped = 1;
+        stop->order = first;
+        stop->offset = offset;
+        stop->line = line;
+        return 1;
+    }
+    return stop->mark != NULL ? stop->mark(stop->markArg, first, offset, line) : 0;
+}
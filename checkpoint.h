@@ -0,0 +1,56 @@
+/*checkpoint.h
+  Saved cache state: the lines, replacement state and statistics of one cache (see cacheSave), along with the
+  position in the trace of the first access it has not simulated. A checkpoint is either resumed, which carries
+  on with the same trace from that position, or used to warm up a run over any trace with the same cache.
+  A checkpoint file is a header followed by the state, in host byte order, and is memory-mapped to be loaded.
+  */
+
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <stdint.h>
+
+#include "cachesim.h"
+#include "pool.h"
+#include "trace.h"
+
+#define CHECKPOINT_MAGIC "CSCP"
+#define CHECKPOINT_VERSION 3
+
+struct CheckpointHeader
+{
+    char magic[4];
+    uint32_t version;
+    int32_t kind; /*enum CacheKind*/
+    int32_t k;
+    int32_t sets;
+    int32_t blockSize;
+    char policy[16]; /*Name of the replacement policy, empty for the legacy victim search*/
+    uint64_t stateSize;
+    int64_t offset; /*traceOffset of the first access not simulated, -1 if the trace cannot seek*/
+    int64_t order; /*# of that access*/
+    int64_t line; /*Last line of the trace read before it*/
+    uint64_t traceLength; /*Size of the trace, 0 if it was not mapped*/
+    uint64_t traceHash; /*traceFingerprint*/
+};
+
+/*Chained into the mark of a PoolInput by checkpointCatch, to stop the run on SIGINT or SIGTERM*/
+struct CheckpointStop
+{
+    int (*mark)(void*, int64_t, long long, int64_t); /*The mark it was chained to, NULL for none*/
+    void* markArg;
+    int stopped; /*Set if the run was interrupted*/
+    int64_t order; /*Position of the first access not simulated, once stopped*/
+    long long offset;
+    int64_t line;
+};
+
+int checkpointSave(const char* filename, const struct Cache* cache, const struct CacheStats* stats,
+                   const struct TraceReader* trace, int64_t order, long long offset, int64_t line);
+int checkpointLoad(const char* filename, struct Cache* cache, struct CacheStats* stats,
+                   struct CheckpointHeader* header);
+int checkpointResume(const struct CheckpointHeader* header, struct TraceReader* trace);
+void checkpointCatch(struct CheckpointStop* stop, struct PoolInput* input);
+int checkpointMark(void* stop, int64_t first, long long offset, int64_t line);
+
+#endif
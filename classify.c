@@ -0,0 +1,146 @@
+/*classify.c
+  3C miss classification, see classify.h.
+  */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "classify.h"
+
+static int seenAllocate(struct Classifier* classes, uint64_t slots)
+{
+    uint64_t s;
+
+    classes->seen = malloc((size_t) slots * sizeof(*classes->seen));
+    if (classes->seen == NULL)
+    {
+        return -1;
+    }
+    for (s = 0; s < slots; s++)
+    {
+        classes->seen[s] = CLASSIFY_EMPTY;
+    }
+    classes->seenMask = slots - 1;
+    classes->seenUsed = 0;
+    return 0;
+}
+
+/*Returns the slot of block, or the empty slot it would go in*/
+static uint64_t seenFind(const struct Classifier* classes, uint64_t block)
+{
+    uint64_t s = ((block * UINT64_C(0x9E3779B97F4A7C15)) >> 32) & classes->seenMask;
+
+    while (classes->seen[s] != block && classes->seen[s] != CLASSIFY_EMPTY)
+    {
+        s = (s + 1) & classes->seenMask;
+    }
+    return s;
+}
+
+/*Double the # of slots, rehashing every block*/
+static int seenGrow(struct Classifier* classes)
+{
+    uint64_t* old = classes->seen;
+    uint64_t oldMask = classes->seenMask;
+    uint64_t used = classes->seenUsed;
+    uint64_t s;
+
+    if (seenAllocate(classes, (oldMask + 1) * 2) != 0)
+    {
+        classes->seen = old;
+        classes->seenMask = oldMask;
+        return -1;
+    }
+    for (s = 0; s <= oldMask; s++)
+    {
+        if (old[s] != CLASSIFY_EMPTY)
+        {
+            classes->seen[seenFind(classes, old[s])] = old[s];
+        }
+    }
+    classes->seenUsed = used;
+    free(old);
+    return 0;
+}
+
+/*Classify the misses of cache, which must be empty. Returns -1 if the memory could not be allocated*/
+int classifyInit(struct Classifier* classes, const struct Cache* cache)
+{
+    memset(classes, 0, sizeof(*classes));
+    classes->offset_size = cache->offset_size;
+    if (seenAllocate(classes, CLASSIFY_SEEN) != 0)
+    {
+        return -1;
+    }
+    if (fullInit(&classes->shadow, cache->cachesize / cache->blockSize) != 0)
+    {
+        free(classes->seen);
+        return -1;
+    }
+    return 0;
+}
+
+/*Run an access of address MEM, a store if write, through the shadow, and classify it if the cache missed.
+ * Returns -1 if the set of seen blocks could not grow*/
+int classifyAccess(struct Classifier* classes, int write, uint64_t MEM, int miss)
+{
+    struct FullCache* shadow = &classes->shadow;
+    uint64_t block = MEM >> classes->offset_size;
+    int line = fullFind(shadow, block);
+    enum MissClass missClass = MISS_CONFLICT;
+
+    if (line != -1)
+    {
+        fullTouch(shadow, line);
+    }
+    else
+    {
+        /*Only a block the shadow does not hold can be new*/
+        uint64_t s = seenFind(classes, block);
+
+        fullFill(shadow, fullVictim(shadow), block);
+        missClass = MISS_CAPACITY;
+        if (classes->seen[s] == CLASSIFY_EMPTY)
+        {
+            missClass = MISS_COMPULSORY;
+            if ((classes->seenUsed + 1) * 2 > classes->seenMask + 1)
+            {
+                if (seenGrow(classes) != 0)
+                {
+                    return -1;
+                }
+                s = seenFind(classes, block);
+            }
+            classes->seen[s] = block;
+            classes->seenUsed++;
+        }
+    }
+
+    if (miss && write)
+    {
+        classes->writes[missClass]++;
+    }
+    else if (miss)
+    {
+        classes->reads[missClass]++;
+    }
+    return 0;
+}
+
+void classifyPrint(const struct Classifier* classes)
+{
+    printf("number of compulsory data read misses = %lu\n", classes->reads[MISS_COMPULSORY]);
+    printf("number of capacity data read misses = %lu\n", classes->reads[MISS_CAPACITY]);
+    printf("number of conflict data read misses = %lu\n", classes->reads[MISS_CONFLICT]);
+    printf("number of compulsory data write misses = %lu\n", classes->writes[MISS_COMPULSORY]);
+    printf("number of capacity data write misses = %lu\n", classes->writes[MISS_CAPACITY]);
+    printf("number of conflict data write misses = %lu\n", classes->writes[MISS_CONFLICT]);
+}
+
+void classifyFree(struct Classifier* classes)
+{
+    fullFree(&classes->shadow);
+    free(classes->seen);
+    classes->seen = NULL;
+}
@@ -0,0 +1,44 @@
+/*classify.h
+  Classification of the misses of a cache into the 3Cs: a miss is compulsory if its block was never used
+  before, a capacity miss if a fully associative LRU cache of the same # of blocks would also have missed,
+  and a conflict miss otherwise. The fully associative shadow is a FullCache (fullassoc.h), so it costs O(1) per
+  access however large the cache is. Blocks seen so far are kept in an open-addressing hash set that doubles
+  when it is half full, which is only looked up when the shadow misses, as the first use of a block always does.
+  */
+
+#ifndef CLASSIFY_H
+#define CLASSIFY_H
+
+#include <stdint.h>
+
+#include "cachesim.h"
+#include "fullassoc.h"
+
+#define CLASSIFY_SEEN 4096 /*Initial # of slots of the set of seen blocks, a power of 2*/
+#define CLASSIFY_EMPTY UINT64_MAX /*Block of an empty slot*/
+
+enum MissClass
+{
+    MISS_COMPULSORY,
+    MISS_CAPACITY,
+    MISS_CONFLICT,
+    MISS_CLASSES
+};
+
+struct Classifier
+{
+    struct FullCache shadow;
+    int offset_size; /*log2 of the block size*/
+    uint64_t* seen; /*Blocks used so far*/
+    uint64_t seenMask; /*# of slots - 1*/
+    uint64_t seenUsed;
+    unsigned long reads[MISS_CLASSES]; /*Read misses of each class*/
+    unsigned long writes[MISS_CLASSES];
+};
+
+int classifyInit(struct Classifier* classes, const struct Cache* cache);
+int classifyAccess(struct Classifier* classes, int write, uint64_t MEM, int miss);
+void classifyPrint(const struct Classifier* classes);
+void classifyFree(struct Classifier* classes);
+
+#endif
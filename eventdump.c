@@ -0,0 +1,143 @@
+/*eventdump.c
+  Renders a binary event log (see eventlog.h) in the tabular format of verbose mode, so that
+  ./sys2 gcc.trace 2 4 -v ic1 ic2 -l log followed by ./eventdump log prints what -v alone would have.
+  The output can be narrowed down to a range of accesses and to a single set.
+  How to execute:
+    1) gcc -O2 -o eventdump eventdump.c eventlog.c -lpthread
+    2) ./sys2 gcc.trace 2 4 -l gcc.log
+       ./eventdump gcc.log -r 1000 2000 -s 17
+        (accesses 1000 to 2000 of set 17)
+  */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "eventlog.h"
+
+#define EVENT_BATCH 4096
+
+/*The header and row of system1.c*/
+static void printDirect(const struct EventRecord* record, int first)
+{
+    if (first)
+    {
+        printf("--The ideal window size for the Terminal to display the results is approximately "
+               "half the screen--\n");
+        printf("%s\t%-10s\t%-12s\t%-12s\t%-10s\t%-12s\t%-10s\t%-10s\t%-10s\n",
+               "order", "MEM", "Index", "tag", "V", "cTag", "dbit", "hitMiss", "Case");
+    }
+    printf("%" PRId64 "\t%-12" PRIx64 "\t%-12" PRIx64 "\t%-12" PRIx64 "\t%-10d\t%-12" PRIx64 "\t%-10d\t%-10d\t%-10s\n",
+           record->order, record->mem, record->index, record->tag, record->valid, record->cTag,
+           record->dirty, record->hitOrMiss, eventCases[record->caseNum]);
+}
+
+/*The header and row of system2.c*/
+static void printKway(const struct EventRecord* record, int first)
+{
+    if (first)
+    {
+        printf("\n--The Terminal should be in full screen to ensure that the verbose mode output is "
+               "printed correctly--\n");
+        printf("%-10s\t%-12s\t%-12s\t%-12s\t%-10s\t%-10s\t%-10s\t%-12s\t%-10s\t%-10s\t%-10s\n",
+               "order", "MEM", "Index", "tag", "V", "D", "LU", "cTag", "dbit", "hitMiss", "Case");
+    }
+    printf("%-10" PRId64 "\t%-12" PRIx64 "\t%-12" PRIx64 "\t%-12" PRIx64 "\t%-10d\t%-10d\t%-10" PRId64 "\t"
+           "%-12" PRIx64 "\t%-10d\t%-10d\t%-10s\n",
+           record->order, record->mem, record->index, record->tag, record->valid, record->way,
+           record->lastUsed, record->cTag, record->dirty, record->hitOrMiss, eventCases[record->caseNum]);
+}
+
+int main(int argc, char* argv[])
+{
+    struct EventLogHeader header;
+    struct EventRecord* records;
+    FILE* in;
+    int64_t first = 0;
+    int64_t last = INT64_MAX;
+    long set = -1;
+    long printed = 0;
+    size_t n;
+    size_t j;
+    int i;
+
+    /*Arguments: logfile [-r first last] [-s set]*/
+    if (argc < 2)
+    {
+        printf("Arguments required: logfile [-r first last] [-s set]\nExiting...\n");
+        exit(EXIT_FAILURE);
+    }
+    for (i = 2; i < argc; i++)
+    {
+        if (strcmp(argv[i], "-r") == 0 && i + 2 < argc)
+        {
+            first = strtoll(argv[i + 1], NULL, 10);
+            last = strtoll(argv[i + 2], NULL, 10);
+            i += 2;
+        }
+        else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc)
+        {
+            set = strtol(argv[++i], NULL, 10);
+        }
+        else
+        {
+            printf("Arguments required: logfile [-r first last] [-s set]\nExiting...\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    in = strcmp(argv[1], "-") == 0 ? stdin : fopen(argv[1], "rb");
+    if (in == NULL)
+    {
+        perror("File could not be found in the current working directory\nExiting...\n");
+        exit(EXIT_FAILURE);
+    }
+    if (fread(&header, sizeof(header), 1, in) != 1 || memcmp(header.magic, EVENTLOG_MAGIC, sizeof(header.magic)) != 0
+        || header.version != EVENTLOG_VERSION)
+    {
+        printf("%s is not an event log of this version\nExiting...\n", argv[1]);
+        exit(EXIT_FAILURE);
+    }
+    records = malloc(EVENT_BATCH * sizeof(*records));
+    if (records == NULL)
+    {
+        perror("Could not allocate the record buffer");
+        exit(EXIT_FAILURE);
+    }
+
+    while ((n = fread(records, sizeof(*records), EVENT_BATCH, in)) > 0)
+    {
+        for (j = 0; j < n; j++)
+        {
+            const struct EventRecord* record = &records[j];
+
+            if (record->order < first || record->order > last || (set != -1 && record->index != (uint64_t) set)
+                || record->caseNum >= EVENT_CASES)
+            {
+                continue;
+            }
+            if (header.kind == CACHE_DIRECT)
+            {
+                printDirect(record, printed == 0);
+            }
+            else
+            {
+                printKway(record, printed == 0);
+            }
+            printed++;
+        }
+    }
+    if (ferror(in))
+    {
+        perror("Could not read the event log");
+        exit(EXIT_FAILURE);
+    }
+
+    free(records);
+    if (in != stdin)
+    {
+        fclose(in);
+    }
+    return 0;
+}
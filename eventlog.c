@@ -0,0 +1,112 @@
+/*eventlog.c
+  Binary event log, see eventlog.h.
+  The simulation fills one buffer while the writer thread writes the others. Full buffers go to the writer
+  and come back empty over a pair of single-producer/single-consumer rings.
+  */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "eventlog.h"
+
+const char* const eventCases[EVENT_CASES] = {"NULL", "1", "2a", "2b"};
+
+static void* eventWriter(void* arg)
+{
+    struct EventLog* log = arg;
+
+    while (1)
+    {
+        struct EventBuffer* buffer = ringWaitPop(&log->full);
+
+        if (buffer->n == 0)
+        {
+            break;
+        }
+        if (fwrite(buffer->records, sizeof(struct EventRecord), buffer->n, log->out) != buffer->n)
+        {
+            log->error = 1;
+        }
+        ringWaitPush(&log->empty, buffer);
+    }
+    return NULL;
+}
+
+/*Create filename and start its writer. Returns -1 if it could not be created*/
+int eventLogOpen(struct EventLog* log, const char* filename, enum CacheKind kind)
+{
+    struct EventLogHeader header;
+    int b;
+
+    memset(log, 0, sizeof(*log));
+    log->out = fopen(filename, "wb");
+    log->buffers = malloc(EVENTLOG_BUFFERS * sizeof(*log->buffers));
+    if (log->out == NULL || log->buffers == NULL || ringInit(&log->full, EVENTLOG_BUFFERS) != 0 ||
+        ringInit(&log->empty, EVENTLOG_BUFFERS) != 0)
+    {
+        return -1;
+    }
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, EVENTLOG_MAGIC, sizeof(header.magic));
+    header.version = EVENTLOG_VERSION;
+    header.kind = (uint32_t) kind;
+    if (fwrite(&header, sizeof(header), 1, log->out) != 1)
+    {
+        return -1;
+    }
+
+    for (b = 1; b < EVENTLOG_BUFFERS; b++)
+    {
+        ringPush(&log->empty, &log->buffers[b]);
+    }
+    log->current = &log->buffers[0];
+    log->current->n = 0;
+    return pthread_create(&log->thread, NULL, eventWriter, log) != 0 ? -1 : 0;
+}
+
+/*Log the access cache just simulated, access # order of address MEM, with base taken off the #s it logs*/
+void eventLogAccess(struct EventLog* log, const struct Cache* cache, int64_t order, int64_t base, uint64_t MEM)
+{
+    struct EventRecord* record = &log->current->records[log->current->n];
+
+    record->mem = MEM;
+    record->index = cache->last.Index;
+    record->tag = cache->last.tag;
+    record->cTag = cache->last.cTag;
+    record->order = order - base;
+    record->way = cache->last.chosenBlock;
+    record->lastUsed = cache->last.lastUsed - base;
+    record->valid = (int8_t) cache->last.valid;
+    record->dirty = (int8_t) cache->last.dbit;
+    record->hitOrMiss = (int8_t) cache->last.hitOrMiss;
+    record->caseNum = (uint8_t) cache->last.caseNum;
+
+    if (++log->current->n == EVENTLOG_RECORDS)
+    {
+        ringWaitPush(&log->full, log->current);
+        log->current = ringWaitPop(&log->empty);
+        log->current->n = 0;
+    }
+}
+
+/*Write what is left and close the log. Returns -1 if any of it could not be written*/
+int eventLogClose(struct EventLog* log)
+{
+    int error;
+
+    if (log->current->n > 0)
+    {
+        ringWaitPush(&log->full, log->current);
+        log->current = ringWaitPop(&log->empty);
+    }
+    log->current->n = 0;
+    ringWaitPush(&log->full, log->current);
+    pthread_join(log->thread, NULL);
+
+    error = log->error || fclose(log->out) != 0;
+    ringFree(&log->full);
+    ringFree(&log->empty);
+    free(log->buffers);
+    return error ? -1 : 0;
+}
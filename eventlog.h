@@ -0,0 +1,72 @@
+/*eventlog.h
+  Binary log of the accesses verbose mode would print, one fixed-width EventRecord per access.
+  Records are collected in large buffers that a background thread writes out, so logging millions of
+  accesses costs a copy per access instead of a formatted printf. eventdump.c renders a log in the
+  tabular format of verbose mode.
+  A log is a header followed by the records, all in host byte order.
+  */
+
+#ifndef EVENTLOG_H
+#define EVENTLOG_H
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "cachesim.h"
+#include "ring.h"
+
+#define EVENTLOG_MAGIC "CSEV"
+#define EVENTLOG_VERSION 2
+#define EVENTLOG_RECORDS 32768 /*# of records per buffer*/
+#define EVENTLOG_BUFFERS 4 /*# of buffers, a power of 2*/
+
+struct EventLogHeader
+{
+    char magic[4];
+    uint32_t version;
+    uint32_t kind; /*enum CacheKind of the logged cache, which picks the columns*/
+    uint32_t reserved;
+};
+
+/*One access, with the state of the block it chose as it was before the access*/
+struct EventRecord
+{
+    uint64_t mem;
+    uint64_t index;
+    uint64_t tag;
+    uint64_t cTag; /*Tag of the chosen block*/
+    int64_t order;
+    int64_t lastUsed; /*LU of the chosen block*/
+    int32_t way; /*Chosen block of the set*/
+    int8_t valid;
+    int8_t dirty;
+    int8_t hitOrMiss;
+    uint8_t caseNum; /*enum CacheCase, the index in eventCases*/
+};
+
+struct EventBuffer
+{
+    size_t n; /*0 stops the writer*/
+    struct EventRecord records[EVENTLOG_RECORDS];
+};
+
+struct EventLog
+{
+    FILE* out;
+    pthread_t thread;
+    struct Ring full; /*Buffers to write*/
+    struct Ring empty; /*Buffers written*/
+    struct EventBuffer* buffers;
+    struct EventBuffer* current; /*Buffer being filled*/
+    int error;
+};
+
+extern const char* const eventCases[]; /*Names of the enum CacheCase values, as verbose mode prints them*/
+#define EVENT_CASES CACHE_CASES
+
+int eventLogOpen(struct EventLog* log, const char* filename, enum CacheKind kind);
+void eventLogAccess(struct EventLog* log, const struct Cache* cache, int64_t order, int64_t base, uint64_t MEM);
+int eventLogClose(struct EventLog* log);
+
+#endif
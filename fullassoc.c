@@ -0,0 +1,208 @@
+/*fullassoc.c
+  Fully associative LRU lines, see fullassoc.h.
+  The hash table uses linear probing. It is kept at most half full, and an evicted block is removed by
+  shifting the rest of its probe run back, so there are no tombstones and lookups stay short.
+  A removed block leaves its line invalid at the tail of the recency list, where the next miss takes it.
+  */
+
+#include <stdlib.h>
+
+#include "fullassoc.h"
+
+static uint64_t fullHash(const struct FullCache* cache, uint64_t block)
+{
+    return (block * 0x9E3779B97F4A7C15ULL >> 32) & cache->mask;
+}
+
+/*Returns -1 if the memory could not be allocated*/
+int fullInit(struct FullCache* cache, int size)
+{
+    uint64_t entries = 2;
+    uint64_t i;
+
+    while (entries < 2 * (uint64_t) size)
+    {
+        entries *= 2;
+    }
+    cache->size = size;
+    cache->used = 0;
+    cache->head = -1;
+    cache->tail = -1;
+    cache->mask = entries - 1;
+    cache->prev = malloc((size_t) size * sizeof(*cache->prev));
+    cache->next = malloc((size_t) size * sizeof(*cache->next));
+    cache->blocks = calloc((size_t) size, sizeof(*cache->blocks));
+    cache->lines = calloc((size_t) size, sizeof(*cache->lines));
+    cache->table = malloc(entries * sizeof(*cache->table));
+    if (cache->prev == NULL || cache->next == NULL || cache->blocks == NULL || cache->lines == NULL ||
+        cache->table == NULL)
+    {
+        fullFree(cache);
+        return -1;
+    }
+    for (i = 0; i < entries; i++)
+    {
+        cache->table[i].line = -1;
+    }
+    return 0;
+}
+
+/*Returns the line holding block, or -1*/
+int fullFind(const struct FullCache* cache, uint64_t block)
+{
+    uint64_t i;
+
+    for (i = fullHash(cache, block); cache->table[i].line != -1; i = (i + 1) & cache->mask)
+    {
+        if (cache->table[i].block == block)
+        {
+            return cache->table[i].line;
+        }
+    }
+    return -1;
+}
+
+static void listRemove(struct FullCache* cache, int line)
+{
+    if (cache->prev[line] != -1)
+    {
+        cache->next[cache->prev[line]] = cache->next[line];
+    }
+    else
+    {
+        cache->head = cache->next[line];
+    }
+    if (cache->next[line] != -1)
+    {
+        cache->prev[cache->next[line]] = cache->prev[line];
+    }
+    else
+    {
+        cache->tail = cache->prev[line];
+    }
+}
+
+static void listPushFront(struct FullCache* cache, int line)
+{
+    cache->prev[line] = -1;
+    cache->next[line] = cache->head;
+    if (cache->head != -1)
+    {
+        cache->prev[cache->head] = line;
+    }
+    else
+    {
+        cache->tail = line;
+    }
+    cache->head = line;
+}
+
+static void listPushBack(struct FullCache* cache, int line)
+{
+    cache->prev[line] = cache->tail;
+    cache->next[line] = -1;
+    if (cache->tail != -1)
+    {
+        cache->next[cache->tail] = line;
+    }
+    else
+    {
+        cache->head = line;
+    }
+    cache->tail = line;
+}
+
+/*Remove block from the table, moving back the entries of its probe run that hash at or before the hole*/
+static void tableRemove(struct FullCache* cache, uint64_t block)
+{
+    uint64_t hole = fullHash(cache, block);
+    uint64_t i;
+
+    while (cache->table[hole].block != block || cache->table[hole].line == -1)
+    {
+        hole = (hole + 1) & cache->mask;
+    }
+    for (i = (hole + 1) & cache->mask; cache->table[i].line != -1; i = (i + 1) & cache->mask)
+    {
+        uint64_t home = fullHash(cache, cache->table[i].block);
+
+        /*The entry may move into the hole if its home is not in (hole, i]*/
+        if (((i - home) & cache->mask) >= ((i - hole) & cache->mask))
+        {
+            cache->table[hole] = cache->table[i];
+            hole = i;
+        }
+    }
+    cache->table[hole].line = -1;
+}
+
+/*Returns the line to fill on a miss: the next empty line, or else the least recently used one,
+ * which is dropped from the table and still holds the state of the evicted block, invalid if it was removed*/
+int fullVictim(struct FullCache* cache)
+{
+    int line;
+
+    if (cache->used < cache->size)
+    {
+        return cache->used++;
+    }
+    line = cache->tail;
+    if (cache->blocks[line] != FULL_REMOVED)
+    {
+        tableRemove(cache, cache->blocks[line]);
+    }
+    listRemove(cache, line);
+    return line;
+}
+
+/*Put block in line, which fullVictim returned, as the most recently used line*/
+void fullFill(struct FullCache* cache, int line, uint64_t block)
+{
+    uint64_t i = fullHash(cache, block);
+
+    while (cache->table[i].line != -1)
+    {
+        i = (i + 1) & cache->mask;
+    }
+    cache->table[i].block = block;
+    cache->table[i].line = line;
+    cache->blocks[line] = block;
+    listPushFront(cache, line);
+}
+
+/*line was hit, make it the most recently used*/
+void fullTouch(struct FullCache* cache, int line)
+{
+    if (cache->head != line)
+    {
+        listRemove(cache, line);
+        listPushFront(cache, line);
+    }
+}
+
+/*Drop the block of line, whose line becomes invalid and the next victim*/
+void fullRemove(struct FullCache* cache, int line)
+{
+    tableRemove(cache, cache->blocks[line]);
+    cache->blocks[line] = FULL_REMOVED;
+    cache->lines[line] = 0;
+    if (cache->tail != line)
+    {
+        listRemove(cache, line);
+        listPushBack(cache, line);
+    }
+}
+
+void fullFree(struct FullCache* cache)
+{
+    free(cache->prev);
+    free(cache->next);
+    free(cache->blocks);
+    free(cache->lines);
+    free(cache->table);
+    cache->prev = NULL;
+    cache->next = NULL;
+    cache->blocks = NULL;
+    cache->lines = NULL;
+    cache->table = NULL;
+}
@@ -0,0 +1,43 @@
+/*fullassoc.h
+  Lines of a fully associative LRU cache, found in O(1) whatever the # of lines.
+  An open addressing hash table maps a block address to its line, and the lines form an intrusive
+  doubly linked recency list, most recent first, so the LRU victim is simply the tail.
+  The caller keeps the valid/dirty state of each line in lines[] (see cacheline.h).
+  */
+
+#ifndef FULLASSOC_H
+#define FULLASSOC_H
+
+#include <stdint.h>
+
+#define FULL_REMOVED UINT64_MAX /*Block of a line whose block was removed, no block address is this large*/
+
+struct FullEntry
+{
+    uint64_t block;
+    int32_t line; /*-1 if the entry is empty*/
+};
+
+struct FullCache
+{
+    int size; /*# of lines*/
+    int used; /*# of lines filled so far, they are filled in order*/
+    int32_t head; /*Most recently used line*/
+    int32_t tail; /*Least recently used line*/
+    int32_t* prev;
+    int32_t* next;
+    uint64_t* blocks; /*Block address held by each line*/
+    uint64_t* lines; /*Packed state of each line*/
+    struct FullEntry* table;
+    uint64_t mask; /*# of table entries - 1, at least 2x the # of lines*/
+};
+
+int fullInit(struct FullCache* cache, int size);
+int fullFind(const struct FullCache* cache, uint64_t block);
+int fullVictim(struct FullCache* cache);
+void fullFill(struct FullCache* cache, int line, uint64_t block);
+void fullTouch(struct FullCache* cache, int line);
+void fullRemove(struct FullCache* cache, int line);
+void fullFree(struct FullCache* cache);
+
+#endif
@@ -0,0 +1,255 @@
+/*hierarchy.c
+  Multi-level cache hierarchy, see hierarchy.h.
+  The levels are caches of cachesim.c, looked up with cacheProbe and filled with cacheFill, so they share the set
+  lookup, victim choice and dirty state of the single caches of system1.c and system2.c. The hierarchy counts the
+  accesses of each level itself.
+  A miss looks the block up level by level until a level or memory has it, then fills the levels above
+  from the bottom up, so an inclusive level already holds a block before the levels above it get it.
+  */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "hierarchy.h"
+
+static void levelFill(struct Hierarchy* hier, int i, uint64_t MEM, int dirty, int64_t order);
+
+/*A dirty block, or with exclusion any block, evicted from level i - 1 arrives at level i*/
+static void levelWriteBack(struct Hierarchy* hier, int i, uint64_t MEM, int dirty, int64_t order)
+{
+    int line;
+
+    if (i == hier->levels)
+    {
+        hier->memoryWrites += dirty;
+        return;
+    }
+    line = cacheProbe(&hier->level[i].cache, MEM);
+    if (line == -1)
+    {
+        levelFill(hier, i, MEM, dirty, order);
+    }
+    else if (dirty)
+    {
+        cacheSetDirty(&hier->level[i].cache, line);
+    }
+}
+
+/*Put the block of MEM in level i, evicting a victim to the level below if the set is full*/
+static void levelFill(struct Hierarchy* hier, int i, uint64_t MEM, int dirty, int64_t order)
+{
+    struct Level* level = &hier->level[i];
+    uint64_t victim;
+    int victimDirty;
+    int line;
+    int j;
+
+    line = cacheFill(&level->cache, MEM, order, &victim, &victimDirty);
+    if (dirty)
+    {
+        cacheSetDirty(&level->cache, line != -1 ? line : cacheProbe(&level->cache, MEM));
+    }
+    if (victim == UINT64_MAX)
+    {
+        return;
+    }
+    if (hier->inclusion == INCLUSIVE)
+    {
+        /*Back-invalidate the copies above, a dirty one is newer than this one*/
+        for (j = 0; j < i; j++)
+        {
+            int upper = cacheInvalidate(&hier->level[j].cache, victim);
+
+            if (upper != -1)
+            {
+                hier->level[j].stats.invalidations++;
+                victimDirty |= upper;
+            }
+        }
+    }
+    if (victimDirty)
+    {
+        level->stats.writebacks++;
+    }
+    if (victimDirty || (hier->inclusion == EXCLUSIVE && i + 1 < hier->levels))
+    {
+        levelWriteBack(hier, i + 1, victim, victimDirty, order);
+    }
+}
+
+/*Returns 0, or -1 for an unknown inclusion name*/
+int hierInclusion(const char* name, enum Inclusion* inclusion)
+{
+    if (strcmp(name, "inclusive") == 0)
+    {
+        *inclusion = INCLUSIVE;
+    }
+    else if (strcmp(name, "exclusive") == 0)
+    {
+        *inclusion = EXCLUSIVE;
+    }
+    else if (strcmp(name, "nine") == 0)
+    {
+        *inclusion = NINE;
+    }
+    else
+    {
+        return -1;
+    }
+    return 0;
+}
+
+int hierInit(struct Hierarchy* hier, int blockSize, enum Inclusion inclusion, int memoryLatency)
+{
+    memset(hier, 0, sizeof(*hier));
+    if (blockSize <= 0 || (blockSize & (blockSize - 1)) != 0)
+    {
+        return -1;
+    }
+    hier->blockSize = blockSize;
+    hier->offset_size = __builtin_ctz((unsigned int) blockSize);
+    hier->inclusion = inclusion;
+    hier->memoryLatency = memoryLatency;
+    return 0;
+}
+
+/*Add the next level below the others, direct-mapped for k = 1. Returns -1 if the geometry is not valid*/
+int hierAddLevel(struct Hierarchy* hier, double input_cachesize, int k, int latency, const struct Policy* policy)
+{
+    struct CacheConfig config = {k == 1 ? CACHE_DIRECT : CACHE_KWAY, input_cachesize, k, policy, hier->blockSize};
+    struct Level* level;
+    double blocks = input_cachesize * 1024 / hier->blockSize;
+    const char* error;
+
+    /*cacheFill needs a replacement policy to pick the victims of a set*/
+    if (hier->levels == HIER_LEVELS || k < 1 || blocks < k || blocks != (double) (long) blocks ||
+        ((long) blocks / k & ((long) blocks / k - 1)) != 0 || (long) blocks % k != 0 || (k > 1 && policy == NULL))
+    {
+        return -1;
+    }
+    level = &hier->level[hier->levels];
+    if (cacheInit(&level->cache, &config, &error) != 0)
+    {
+        return -1;
+    }
+    level->policy = k > 1 ? policy : NULL;
+    level->latency = latency;
+    hier->levels++;
+    return 0;
+}
+
+/*Simulate one load (Ld_St = 'L') or store (Ld_St = 'S') of address MEM, order is the # of the access*/
+void hierAccess(struct Hierarchy* hier, char Ld_St, uint64_t MEM, int64_t order)
+{
+    int dirty = 0;
+    int write = Ld_St == 'S';
+    int i;
+    int j;
+
+    if (write)
+    {
+        hier->writes++;
+    }
+    else
+    {
+        hier->reads++;
+    }
+
+    /*Look the block up level by level*/
+    for (i = 0; i < hier->levels; i++)
+    {
+        struct Level* level = &hier->level[i];
+        int line = cacheProbe(&level->cache, MEM);
+
+        level->stats.accesses++;
+        hier->cycles += level->latency;
+        if (line == -1)
+        {
+            level->stats.misses++;
+            continue;
+        }
+
+        if (i > 0 && hier->inclusion == EXCLUSIVE)
+        {
+            dirty = cacheInvalidate(&level->cache, MEM); /*Moves up to L1, taking its dirty state along*/
+        }
+        else
+        {
+            cacheTouch(&level->cache, line, order, i == 0 && write);
+        }
+        break;
+    }
+    if (i == 0)
+    {
+        return;
+    }
+    if (i == hier->levels)
+    {
+        hier->cycles += hier->memoryLatency;
+        hier->memoryReads++;
+    }
+
+    /*Fill the levels above the one that had the block, bottom up*/
+    for (j = i - 1; j >= 0; j--)
+    {
+        if (j == 0)
+        {
+            levelFill(hier, 0, MEM, dirty || write, order);
+        }
+        else if (hier->inclusion != EXCLUSIVE)
+        {
+            levelFill(hier, j, MEM, 0, order);
+        }
+    }
+}
+
+void hierRun(void* arg, const struct TraceRecord* records, int n, int64_t first)
+{
+    struct Hierarchy* hier = arg;
+    int j;
+
+    for (j = 0; j < n; j++)
+    {
+        hierAccess(hier, traceOp(&records[j]), records[j].mem, first + j);
+    }
+}
+
+void hierPrint(const struct Hierarchy* hier)
+{
+    static const char* names[] = {"inclusive", "exclusive", "nine"};
+    unsigned long accesses = hier->reads + hier->writes;
+    int i;
+
+    printf("\nhierarchy = %s, %d levels\n", names[hier->inclusion], hier->levels);
+    printf("number of data reads = %lu\n", hier->reads);
+    printf("number of data writes = %lu\n", hier->writes);
+    for (i = 0; i < hier->levels; i++)
+    {
+        const struct Level* level = &hier->level[i];
+
+        printf("L%d: size = %gKB, k = %d, latency = %d cycles, replacement = %s\n", i + 1, level->cache.input_cachesize,
+               level->cache.k, level->latency, level->policy != NULL ? level->policy->name : "none");
+        printf("    number of accesses = %lu\n", level->stats.accesses);
+        printf("    number of misses = %lu\n", level->stats.misses);
+        printf("    local miss rate = %f\n",
+               level->stats.accesses > 0 ? (double) level->stats.misses / level->stats.accesses : 0.0);
+        printf("    global miss rate = %f\n", accesses > 0 ? (double) level->stats.misses / accesses : 0.0);
+        printf("    number of dirty write-backs = %lu\n", level->stats.writebacks);
+        printf("    number of back-invalidations = %lu\n", level->stats.invalidations);
+    }
+    printf("number of bytes read from memory = %lu\n", hier->memoryReads << hier->offset_size);
+    printf("number of bytes written to memory = %lu\n", hier->memoryWrites << hier->offset_size);
+    printf("total access time (in cycles) = %lu\n", hier->cycles);
+    printf("average access time (in cycles) = %f\n", accesses > 0 ? (double) hier->cycles / accesses : 0.0);
+}
+
+void hierFree(struct Hierarchy* hier)
+{
+    int i;
+
+    for (i = 0; i < hier->levels; i++)
+    {
+        cacheFree(&hier->level[i].cache);
+    }
+}
@@ -0,0 +1,72 @@
+/*hierarchy.h
+  A hierarchy of up to HIER_LEVELS caches (L1, L2, L3) in front of memory, simulated in one pass over the trace.
+  Every level is a write-back, write-allocate cache of cachesim.h, direct-mapped for k = 1 and set associative
+  with a replacement policy otherwise, with its own hit latency and statistics. How the levels share blocks is set
+  by the inclusion:
+    inclusive: every block of a level is also in the levels below it. A block evicted from a lower level
+      is invalidated in the levels above it (back-invalidation).
+    exclusive: a block is in at most one level. Misses fill only L1, and a block evicted from a level moves
+      down to the next one, clean or dirty, while a block hit in a lower level moves up to L1.
+    nine: non-inclusive non-exclusive. Misses fill every level on the way up, and evictions only write back
+      dirty blocks, which are allocated in the next level if they are not already there.
+  A write-back that leaves the last level is a write to memory. Write-backs are buffered and add no cycles.
+  */
+
+#ifndef HIERARCHY_H
+#define HIERARCHY_H
+
+#include <stdint.h>
+
+#include "cachesim.h"
+#include "policy.h"
+#include "trace.h"
+
+#define HIER_LEVELS 3
+
+enum Inclusion
+{
+    INCLUSIVE,
+    EXCLUSIVE,
+    NINE
+};
+
+struct LevelStats
+{
+    unsigned long accesses; /*Demand lookups that reached the level*/
+    unsigned long misses;
+    unsigned long writebacks; /*Dirty blocks evicted to the level below, or to memory*/
+    unsigned long invalidations; /*Blocks invalidated because an inclusive level below evicted them*/
+};
+
+struct Level
+{
+    struct Cache cache;
+    const struct Policy* policy; /*NULL for a direct-mapped level*/
+    int latency; /*Cycles for a lookup in this level*/
+    struct LevelStats stats;
+};
+
+struct Hierarchy
+{
+    int levels;
+    int blockSize; /*Bytes, which all levels share*/
+    int offset_size; /*log2 of the block size*/
+    enum Inclusion inclusion;
+    int memoryLatency;
+    struct Level level[HIER_LEVELS];
+    unsigned long reads; /*Loads*/
+    unsigned long writes; /*Stores*/
+    unsigned long cycles; /*Total access time of all loads and stores*/
+    unsigned long memoryReads; /*Blocks read from memory*/
+    unsigned long memoryWrites; /*Blocks written to memory*/
+};
+
+int hierInit(struct Hierarchy* hier, int blockSize, enum Inclusion inclusion, int memoryLatency);
+int hierAddLevel(struct Hierarchy* hier, double input_cachesize, int k, int latency, const struct Policy* policy);
+void hierAccess(struct Hierarchy* hier, char Ld_St, uint64_t MEM, int64_t order);
+void hierRun(void* hier, const struct TraceRecord* records, int n, int64_t first);
+void hierPrint(const struct Hierarchy* hier);
+void hierFree(struct Hierarchy* hier);
+int hierInclusion(const char* name, enum Inclusion* inclusion);
+
+#endif
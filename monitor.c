@@ -0,0 +1,174 @@
+/*monitor.c
+  Time series and per-set counters, see monitor.h.
+  Snapshots go to the writer and come back over a pair of single-producer/single-consumer rings, as the
+  buffers of eventlog.c do.
+  */
+
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "monitor.h"
+
+static void* monitorWriter(void* arg)
+{
+    struct Monitor* monitor = arg;
+    struct MonitorSnapshot* previous = &monitor->previous;
+    long interval = 0;
+
+    while (1)
+    {
+        struct MonitorSnapshot* snapshot = ringWaitPop(&monitor->full);
+        const struct CacheStats* now = &snapshot->stats;
+        const struct CacheStats* before = &previous->stats;
+        unsigned long accesses;
+        unsigned long misses;
+
+        if (snapshot->last == -1)
+        {
+            break;
+        }
+        accesses = now->dataAccesses - before->dataAccesses;
+        misses = now->readMisses + now->writeMisses - before->readMisses - before->writeMisses;
+        if (fprintf(monitor->series, "%ld,%" PRId64 ",%" PRId64 ",%lu,%lu,%lu,%lu,%lu,%lu,%lu,%f,%lu,%lu,%lu,%lu\n",
+                    interval, previous->last + 1 - monitor->base, snapshot->last - monitor->base, accesses,
+                    now->dataReads - before->dataReads, now->dataWrites - before->dataWrites, misses,
+                    now->readMisses - before->readMisses, now->writeMisses - before->writeMisses,
+                    now->dReadMisses + now->dWriteMisses - before->dReadMisses - before->dWriteMisses,
+                    accesses > 0 ? (double) misses / accesses : 0.0, now->bytesRead - before->bytesRead,
+                    now->bytesWritten - before->bytesWritten, now->readCycles - before->readCycles,
+                    now->writeCycles - before->writeCycles) < 0)
+        {
+            monitor->error = 1;
+        }
+        *previous = *snapshot;
+        interval++;
+        ringWaitPush(&monitor->empty, snapshot);
+    }
+    return NULL;
+}
+
+/*Monitor cache, writing a line to seriesName every interval accesses and the counters of every set to setsName
+ * on monitorClose, either of which may be NULL. The next access is # first, with stats counted so far, and the
+ * time series numbers the accesses from base. Returns -1 if a file could not be created*/
+int monitorOpen(struct Monitor* monitor, const struct Cache* cache, const char* seriesName, int interval,
+                const char* setsName, int64_t first, int64_t base, const struct CacheStats* stats)
+{
+    int s;
+
+    memset(monitor, 0, sizeof(*monitor));
+    monitor->interval = interval;
+    monitor->left = interval;
+    monitor->snapshotted = first - 1;
+    monitor->base = base;
+    monitor->previous.last = first - 1;
+    monitor->previous.stats = *stats;
+    monitor->setsName = setsName;
+    if (setsName != NULL)
+    {
+        monitor->nsets = cache->sets;
+        monitor->sets = calloc((size_t) cache->sets, sizeof(*monitor->sets));
+        if (monitor->sets == NULL)
+        {
+            return -1;
+        }
+    }
+    if (seriesName == NULL)
+    {
+        return 0;
+    }
+
+    monitor->series = fopen(seriesName, "w");
+    monitor->snapshots = malloc(MONITOR_SNAPSHOTS * sizeof(*monitor->snapshots));
+    if (monitor->series == NULL || monitor->snapshots == NULL || ringInit(&monitor->full, MONITOR_SNAPSHOTS) != 0 ||
+        ringInit(&monitor->empty, MONITOR_SNAPSHOTS) != 0)
+    {
+        return -1;
+    }
+    fprintf(monitor->series, "interval,first,last,accesses,reads,writes,misses,read_misses,write_misses,"
+            "dirty_misses,miss_rate,bytes_read,bytes_written,read_cycles,write_cycles\n");
+    for (s = 0; s < MONITOR_SNAPSHOTS; s++)
+    {
+        ringPush(&monitor->empty, &monitor->snapshots[s]);
+    }
+    return pthread_create(&monitor->thread, NULL, monitorWriter, monitor) != 0 ? -1 : 0;
+}
+
+/*Hand the statistics after access # last to the writer*/
+void monitorSnapshot(struct Monitor* monitor, int64_t last, const struct CacheStats* stats)
+{
+    struct MonitorSnapshot* snapshot = ringWaitPop(&monitor->empty);
+
+    snapshot->last = last;
+    snapshot->stats = *stats;
+    ringWaitPush(&monitor->full, snapshot);
+    monitor->snapshotted = last;
+}
+
+/*Simulate records[0..n-1], the first being access # first, through the batch kernel of cache, stopping at
+ * the end of each interval for its snapshot. For a time series without per-set counters*/
+void monitorBatch(struct Monitor* monitor, struct Cache* cache, const struct TraceRecord* records, int n,
+                  int64_t first, struct CacheStats* stats)
+{
+    while (n > 0)
+    {
+        int part = n < monitor->left ? n : monitor->left;
+
+        cacheSimulateBatch(cache, records, (size_t) part, first, stats);
+        records += part;
+        first += part;
+        n -= part;
+        monitor->left -= part;
+        if (monitor->left == 0)
+        {
+            monitorSnapshot(monitor, first - 1, stats);
+            monitor->left = monitor->interval;
+        }
+    }
+}
+
+/*Write the interval still open, which ended with access # last, and the counters of the sets.
+ * Returns -1 if any of it could not be written*/
+int monitorClose(struct Monitor* monitor, int64_t last, const struct CacheStats* stats)
+{
+    int error = 0;
+    int s;
+
+    if (monitor->series != NULL)
+    {
+        if (last > monitor->snapshotted)
+        {
+            monitorSnapshot(monitor, last, stats);
+        }
+        monitorSnapshot(monitor, -1, stats);
+        pthread_join(monitor->thread, NULL);
+        error = monitor->error || fclose(monitor->series) != 0;
+        ringFree(&monitor->full);
+        ringFree(&monitor->empty);
+        free(monitor->snapshots);
+    }
+
+    if (monitor->sets != NULL)
+    {
+        FILE* out = fopen(monitor->setsName, "w");
+
+        if (out == NULL)
+        {
+            error = 1;
+        }
+        else
+        {
+            fprintf(out, "set,accesses,hits,misses,evictions,writebacks,miss_rate\n");
+            for (s = 0; s < monitor->nsets; s++)
+            {
+                const struct MonitorSet* set = &monitor->sets[s];
+
+                fprintf(out, "%d,%lu,%lu,%lu,%lu,%lu,%f\n", s, set->accesses, set->hits, set->misses, set->evictions,
+                        set->writebacks, set->accesses > 0 ? (double) set->misses / set->accesses : 0.0);
+            }
+            error |= ferror(out) || fclose(out) != 0;
+        }
+        free(monitor->sets);
+    }
+    return error ? -1 : 0;
+}
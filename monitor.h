@@ -0,0 +1,88 @@
+/*monitor.h
+  Time series and per-set counters of a cache, to find program phases and conflict hotspots without verbose mode.
+  Every interval accesses, a snapshot of the CacheStats of the cache is handed to a background thread, which
+  writes the difference from the previous one as a line of CSV, so the simulation only copies a CacheStats
+  per interval, and can still run whole batches up to the end of each interval (monitorBatch).
+  Every set counts its own hits, misses, evictions of valid blocks and write-backs of dirty ones,
+  written as CSV when the monitor is closed.
+  As in pcstats.h, the outcome of an access is read off the cycles it added to the CacheStats, and its set and
+  the block it replaced off cache->last.
+  */
+
+#ifndef MONITOR_H
+#define MONITOR_H
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "cachesim.h"
+#include "ring.h"
+
+#define MONITOR_INTERVAL 100000 /*Default # of accesses per interval*/
+#define MONITOR_SNAPSHOTS 64 /*# of snapshots in flight to the writer, a power of 2*/
+
+struct MonitorSet
+{
+    unsigned long accesses;
+    unsigned long hits;
+    unsigned long misses;
+    unsigned long evictions; /*Misses that replaced a valid block*/
+    unsigned long writebacks; /*Misses that replaced a dirty block*/
+};
+
+/*The statistics of the cache after access # last*/
+struct MonitorSnapshot
+{
+    int64_t last; /*-1 stops the writer*/
+    struct CacheStats stats;
+};
+
+struct Monitor
+{
+    int interval;
+    int left; /*# of accesses until the next snapshot*/
+    FILE* series; /*NULL for no time series*/
+    pthread_t thread;
+    struct Ring full; /*Snapshots to write*/
+    struct Ring empty; /*Snapshots written*/
+    struct MonitorSnapshot* snapshots;
+    struct MonitorSnapshot previous; /*The last snapshot written, only used by the writer*/
+    int64_t snapshotted; /*# of the last access of the last snapshot taken*/
+    int64_t base; /*Taken off the #s written*/
+    int error;
+    const char* setsName; /*NULL for no per-set counters*/
+    struct MonitorSet* sets;
+    int nsets;
+};
+
+int monitorOpen(struct Monitor* monitor, const struct Cache* cache, const char* seriesName, int interval,
+                const char* setsName, int64_t first, int64_t base, const struct CacheStats* stats);
+void monitorSnapshot(struct Monitor* monitor, int64_t last, const struct CacheStats* stats);
+void monitorBatch(struct Monitor* monitor, struct Cache* cache, const struct TraceRecord* records, int n,
+                  int64_t first, struct CacheStats* stats);
+int monitorClose(struct Monitor* monitor, int64_t last, const struct CacheStats* stats);
+
+/*Count access # order, which cache just simulated in cycles, into the set it mapped to and the interval*/
+static inline void monitorAccess(struct Monitor* monitor, const struct Cache* cache, int64_t order,
+                                 unsigned long cycles, const struct CacheStats* stats)
+{
+    if (monitor->sets != NULL)
+    {
+        struct MonitorSet* set = &monitor->sets[cache->last.Index];
+        unsigned long miss = cycles > 1;
+
+        set->accesses++;
+        set->hits += cycles == 1;
+        set->misses += miss;
+        set->evictions += miss & (unsigned long) (cache->last.valid != 0);
+        set->writebacks += cycles > 1 + CACHE_MISS_PENALTY;
+    }
+    if (monitor->series != NULL && --monitor->left == 0)
+    {
+        monitorSnapshot(monitor, order, stats);
+        monitor->left = monitor->interval;
+    }
+}
+
+#endif
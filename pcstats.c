@@ -0,0 +1,188 @@
+/*pcstats.c
+  Miss attribution by instruction, see pcstats.h.
+  */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "pcstats.h"
+
+static int pcAllocate(struct PcTable* table, uint64_t slots)
+{
+    uint64_t s;
+
+    table->entries = calloc((size_t) slots, sizeof(*table->entries));
+    if (table->entries == NULL)
+    {
+        return -1;
+    }
+    for (s = 0; s < slots; s++)
+    {
+        table->entries[s].pc = PC_EMPTY;
+    }
+    table->mask = slots - 1;
+    table->used = 0;
+    return 0;
+}
+
+int pcTableInit(struct PcTable* table)
+{
+    return pcAllocate(table, PC_TABLE_SLOTS);
+}
+
+/*Fibonacci hashing, so that PCs a few instructions apart land in unrelated slots*/
+static inline uint64_t pcSlot(const struct PcTable* table, uint64_t pc)
+{
+    return ((pc * UINT64_C(0x9E3779B97F4A7C15)) >> 32) & table->mask;
+}
+
+/*Returns the entry of pc, or the empty slot it would go in*/
+static inline struct PcEntry* pcFind(const struct PcTable* table, uint64_t pc)
+{
+    uint64_t s = pcSlot(table, pc);
+
+    while (table->entries[s].pc != pc && table->entries[s].pc != PC_EMPTY)
+    {
+        s = (s + 1) & table->mask;
+    }
+    return &table->entries[s];
+}
+
+/*Double the # of slots, rehashing every entry*/
+static int pcGrow(struct PcTable* table)
+{
+    struct PcTable grown;
+    uint64_t s;
+
+    if (pcAllocate(&grown, (table->mask + 1) * 2) != 0)
+    {
+        return -1;
+    }
+    for (s = 0; s <= table->mask; s++)
+    {
+        if (table->entries[s].pc != PC_EMPTY)
+        {
+            *pcFind(&grown, table->entries[s].pc) = table->entries[s];
+        }
+    }
+    grown.used = table->used;
+    free(table->entries);
+    *table = grown;
+    return 0;
+}
+
+/*Give pc an entry, growing the table first if it is half full. Kept out of line, as it runs once per PC*/
+static __attribute__((noinline)) struct PcEntry* pcClaim(struct PcTable* table, uint64_t pc)
+{
+    struct PcEntry* entry;
+
+    if ((table->used + 1) * 2 > table->mask + 1 && pcGrow(table) != 0)
+    {
+        return NULL;
+    }
+    entry = pcFind(table, pc);
+    entry->pc = pc;
+    table->used++;
+    return entry;
+}
+
+/*Count an access of the instruction at pc, a store if write, that took cycles.
+ * Returns -1 if the table was full and could not grow*/
+int pcCount(struct PcTable* table, uint64_t pc, int write, unsigned long cycles)
+{
+    struct PcEntry* entry = pcFind(table, pc);
+
+    if (entry->pc != pc && (entry = pcClaim(table, pc)) == NULL)
+    {
+        return -1;
+    }
+    entry->accesses++;
+    if (cycles > 1)
+    {
+        if (write)
+        {
+            entry->writeMisses++;
+        }
+        else
+        {
+            entry->readMisses++;
+        }
+        entry->dirtyEvictions += cycles > 1 + CACHE_MISS_PENALTY;
+        entry->missCycles += cycles - 1;
+    }
+    return 0;
+}
+
+/*Most miss cycles first, then most misses*/
+static int pcCompare(const void* a, const void* b)
+{
+    const struct PcEntry* x = *(const struct PcEntry* const*) a;
+    const struct PcEntry* y = *(const struct PcEntry* const*) b;
+    unsigned long xMisses = x->readMisses + x->writeMisses;
+    unsigned long yMisses = y->readMisses + y->writeMisses;
+
+    if (x->missCycles != y->missCycles)
+    {
+        return x->missCycles < y->missCycles ? 1 : -1;
+    }
+    if (xMisses != yMisses)
+    {
+        return xMisses < yMisses ? 1 : -1;
+    }
+    return x->pc < y->pc ? -1 : x->pc > y->pc;
+}
+
+/*Print the top instructions by miss cycles*/
+void pcPrint(const struct PcTable* table, int top)
+{
+    const struct PcEntry** sorted;
+    unsigned long totalCycles = 0;
+    unsigned long topCycles = 0;
+    uint64_t n = 0;
+    uint64_t s;
+    int i;
+
+    sorted = malloc((size_t) (table->used > 0 ? table->used : 1) * sizeof(*sorted));
+    if (sorted == NULL)
+    {
+        perror("Could not sort the instructions");
+        return;
+    }
+    for (s = 0; s <= table->mask; s++)
+    {
+        if (table->entries[s].pc != PC_EMPTY)
+        {
+            sorted[n++] = &table->entries[s];
+            totalCycles += table->entries[s].missCycles;
+        }
+    }
+    qsort(sorted, (size_t) n, sizeof(*sorted), pcCompare);
+    if ((uint64_t) top > n)
+    {
+        top = (int) n;
+    }
+
+    printf("\ntop %d of %" PRIu64 " instructions by miss cycles\n", top, n);
+    printf("%-18s\t%-12s\t%-12s\t%-12s\t%-12s\t%-14s\t%-10s\t%-10s\n", "PC", "accesses", "read misses",
+           "write misses", "dirty evicts", "miss cycles", "miss rate", "% cycles");
+    for (i = 0; i < top; i++)
+    {
+        const struct PcEntry* entry = sorted[i];
+
+        topCycles += entry->missCycles;
+        printf("0x%-16" PRIx64 "\t%-12lu\t%-12lu\t%-12lu\t%-12lu\t%-14lu\t%-10f\t%-10.2f\n", entry->pc,
+               entry->accesses, entry->readMisses, entry->writeMisses, entry->dirtyEvictions, entry->missCycles,
+               (double) (entry->readMisses + entry->writeMisses) / entry->accesses,
+               totalCycles > 0 ? 100.0 * entry->missCycles / totalCycles : 0.0);
+    }
+    printf("these %d instructions account for %.2f%% of the miss cycles\n", top,
+           totalCycles > 0 ? 100.0 * topCycles / totalCycles : 0.0);
+    free(sorted);
+}
+
+void pcTableFree(struct PcTable* table)
+{
+    free(table->entries);
+    table->entries = NULL;
+}
@@ -0,0 +1,42 @@
+/*pcstats.h
+  Miss attribution by instruction: an open-addressing hash table keyed by ProgramCounter, with linear probing
+  in a power of 2 # of slots that doubles whenever it is half full. Every access of a cache is counted in the
+  entry of its PC, which tells which loads and stores cause the misses of a trace.
+  The outcome of an access is read off the cycles it added to the CacheStats of the cache: 1 for a hit,
+  1 + CACHE_MISS_PENALTY for a clean miss and 1 + 2 * CACHE_MISS_PENALTY for a miss that evicted a dirty block,
+  the same for every kind of cache and replacement policy.
+  */
+
+#ifndef PCSTATS_H
+#define PCSTATS_H
+
+#include <stdint.h>
+
+#include "cachesim.h"
+
+#define PC_TABLE_SLOTS 1024 /*Initial # of slots, a power of 2*/
+#define PC_EMPTY UINT64_MAX /*PC of an empty slot, which no trace has as PCs are 56 bits*/
+
+struct PcEntry
+{
+    uint64_t pc;
+    unsigned long accesses;
+    unsigned long readMisses;
+    unsigned long writeMisses;
+    unsigned long dirtyEvictions; /*Misses that wrote a dirty block back to memory*/
+    unsigned long missCycles; /*Cycles spent waiting for memory, beyond the 1 cycle of a hit*/
+};
+
+struct PcTable
+{
+    struct PcEntry* entries;
+    uint64_t mask; /*# of slots - 1*/
+    uint64_t used;
+};
+
+int pcTableInit(struct PcTable* table);
+int pcCount(struct PcTable* table, uint64_t pc, int write, unsigned long cycles);
+void pcPrint(const struct PcTable* table, int top);
+void pcTableFree(struct PcTable* table);
+
+#endif
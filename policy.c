@@ -0,0 +1,296 @@
+/*policy.c
+  Replacement policies, see policy.h.
+  lru: true LRU in O(1), the ways of a set form a doubly linked recency list, most recent first.
+  plru: tree pseudo-LRU, k - 1 bits per set, each pointing away from the most recently used half.
+  srrip/brrip: re-reference interval prediction with 2 bits per way. SRRIP inserts with a long
+    re-reference interval, BRRIP with a distant one and only occasionally a long one.
+  fifo: evicts the ways in the order they were filled.
+  random: evicts a random way.
+  */
+
+#include <string.h>
+
+#include "policy.h"
+
+#define RRPV_MAX 3 /*Distant re-reference*/
+#define RRPV_LONG 2
+#define BRRIP_LONG_ODDS 32 /*BRRIP inserts with RRPV_LONG once every 32 fills*/
+#define WAYS_16 65536 /*Ways a uint16_t way # can name*/
+
+/*lru: state is head, tail, then prev[k] and next[k], way #s of 16 bits*/
+static size_t lruSize(int k)
+{
+    return (2 + 2 * (size_t) k) * sizeof(uint16_t);
+}
+
+static void lruInit(void* state, int k)
+{
+    uint16_t* list = state;
+    uint16_t* prev = list + 2;
+    uint16_t* next = prev + k;
+    int i;
+
+    list[0] = 0;
+    list[1] = (uint16_t) (k - 1);
+    for (i = 0; i < k; i++)
+    {
+        prev[i] = (uint16_t) (i - 1);
+        next[i] = (uint16_t) (i + 1);
+    }
+}
+
+/*Move way to the front of the recency list*/
+static void lruTouch(void* state, int k, int way)
+{
+    uint16_t* list = state;
+    uint16_t* prev = list + 2;
+    uint16_t* next = prev + k;
+
+    if (list[0] == way)
+    {
+        return;
+    }
+    /*Unlink, way is not the head so it has a predecessor*/
+    next[prev[way]] = next[way];
+    if (list[1] == way)
+    {
+        list[1] = prev[way];
+    }
+    else
+    {
+        prev[next[way]] = prev[way];
+    }
+    next[way] = list[0];
+    prev[list[0]] = (uint16_t) way;
+    list[0] = (uint16_t) way;
+}
+
+static void lruInsert(void* state, int k, int way, uint64_t seed)
+{
+    (void) seed;
+    lruTouch(state, k, way);
+}
+
+static int lruVictim(void* state, int k, uint64_t seed)
+{
+    (void) k;
+    (void) seed;
+    return ((uint16_t*) state)[1];
+}
+
+/*plru: bit i - 1 is node i of the tree, the children of node i are 2i and 2i + 1, the ways are its leaves.
+ * A bit of 1 means the victim is in the right half*/
+static size_t plruSize(int k)
+{
+    return ((size_t) k + 63) / 64 * sizeof(uint64_t);
+}
+
+static void plruInit(void* state, int k)
+{
+    memset(state, 0, plruSize(k));
+}
+
+static void plruTouch(void* state, int k, int way)
+{
+    uint64_t* bits = state;
+    int node = 1;
+    int half;
+
+    for (half = k / 2; half >= 1; half /= 2)
+    {
+        int right = (way & half) != 0;
+
+        if (right)
+        {
+            bits[(node - 1) / 64] &= ~((uint64_t) 1 << ((node - 1) % 64));
+        }
+        else
+        {
+            bits[(node - 1) / 64] |= (uint64_t) 1 << ((node - 1) % 64);
+        }
+        node = 2 * node + right;
+    }
+}
+
+static void plruInsert(void* state, int k, int way, uint64_t seed)
+{
+    (void) seed;
+    plruTouch(state, k, way);
+}
+
+static int plruVictim(void* state, int k, uint64_t seed)
+{
+    uint64_t* bits = state;
+    int node = 1;
+    int way = 0;
+    int half;
+
+    (void) seed;
+    for (half = k / 2; half >= 1; half /= 2)
+    {
+        int right = (bits[(node - 1) / 64] >> ((node - 1) % 64)) & 1;
+
+        way |= right ? half : 0;
+        node = 2 * node + right;
+    }
+    return way;
+}
+
+/*srrip/brrip: one re-reference prediction value per way*/
+static size_t rripSize(int k)
+{
+    return (size_t) k;
+}
+
+static void rripInit(void* state, int k)
+{
+    memset(state, RRPV_MAX, (size_t) k);
+}
+
+static void rripTouch(void* state, int k, int way)
+{
+    (void) k;
+    ((uint8_t*) state)[way] = 0;
+}
+
+static void srripInsert(void* state, int k, int way, uint64_t seed)
+{
+    (void) k;
+    (void) seed;
+    ((uint8_t*) state)[way] = RRPV_LONG;
+}
+
+static void brripInsert(void* state, int k, int way, uint64_t seed)
+{
+    (void) k;
+    ((uint8_t*) state)[way] = seed % BRRIP_LONG_ODDS == 0 ? RRPV_LONG : RRPV_MAX;
+}
+
+/*The first way predicted to be re-referenced in the distant future, ageing the set until there is one*/
+static int rripVictim(void* state, int k, uint64_t seed)
+{
+    uint8_t* rrpv = state;
+    int i;
+
+    (void) seed;
+    for (;;)
+    {
+        for (i = 0; i < k; i++)
+        {
+            if (rrpv[i] == RRPV_MAX)
+            {
+                return i;
+            }
+        }
+        for (i = 0; i < k; i++)
+        {
+            rrpv[i]++;
+        }
+    }
+}
+
+/*fifo: the next way to evict, 16 bits. Empty ways are filled in order, so after the first k fills it simply rotates*/
+static size_t fifoSize(int k)
+{
+    (void) k;
+    return sizeof(uint16_t);
+}
+
+static void fifoInit(void* state, int k)
+{
+    (void) k;
+    *(uint16_t*) state = 0;
+}
+
+/*For the policies that ignore hits*/
+static void noTouch(void* state, int k, int way)
+{
+    (void) state;
+    (void) k;
+    (void) way;
+}
+
+static void fifoInsert(void* state, int k, int way, uint64_t seed)
+{
+    (void) seed;
+    *(uint16_t*) state = (uint16_t) ((way + 1) % k);
+}
+
+static int fifoVictim(void* state, int k, uint64_t seed)
+{
+    (void) k;
+    (void) seed;
+    return *(uint16_t*) state;
+}
+
+/*random: no state*/
+static size_t randomSize(int k)
+{
+    (void) k;
+    return 0;
+}
+
+static void randomInit(void* state, int k)
+{
+    (void) state;
+    (void) k;
+}
+
+static void randomInsert(void* state, int k, int way, uint64_t seed)
+{
+    (void) seed;
+    noTouch(state, k, way); /*Nothing to remember*/
+}
+
+static int randomVictim(void* state, int k, uint64_t seed)
+{
+    (void) state;
+    return (int) (seed % (uint64_t) k);
+}
+
+static const struct Policy policies[] =
+{
+    {"lru", 0, WAYS_16, lruSize, lruInit, lruTouch, lruInsert, lruVictim},
+    {"plru", 1, 0, plruSize, plruInit, plruTouch, plruInsert, plruVictim},
+    {"srrip", 0, 0, rripSize, rripInit, rripTouch, srripInsert, rripVictim},
+    {"brrip", 0, 0, rripSize, rripInit, rripTouch, brripInsert, rripVictim},
+    {"fifo", 0, WAYS_16, fifoSize, fifoInit, noTouch, fifoInsert, fifoVictim},
+    {"random", 0, 0, randomSize, randomInit, noTouch, randomInsert, randomVictim},
+};
+
+/*Returns NULL for an unknown name*/
+const struct Policy* policyFind(const char* name)
+{
+    size_t i;
+
+    for (i = 0; i < sizeof(policies) / sizeof(policies[0]); i++)
+    {
+        if (strcmp(policies[i].name, name) == 0)
+        {
+            return &policies[i];
+        }
+    }
+    return NULL;
+}
+
+const char* policyNames(void)
+{
+    return "lru, plru, srrip, brrip, fifo, random";
+}
+
+/*Bytes between the states of 2 sets, keeping every state 8 byte aligned*/
+size_t policyStride(const struct Policy* policy, int k)
+{
+    return (policy->stateSize(k) + 7) / 8 * 8;
+}
+
+/*A well mixed 64-bit hash of the set and the # of the access (the splitmix64 finalizer)*/
+uint64_t policySeed(uint64_t set, int64_t order)
+{
+    uint64_t x = (set << 32) ^ (uint64_t) order;
+
+    x += 0x9E3779B97F4A7C15ULL;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+}
@@ -0,0 +1,31 @@
+/*policy.h
+  Replacement policies of the k-way cache. Every set keeps its own policy state, policyStateSize(k) bytes of it,
+  which the policy is told about on every hit (touch) and every fill (insert), and asked for a victim way
+  when a miss finds the set full. seed is a hash of the access, for the policies that make random choices,
+  so a run is reproducible and does not depend on the order the sets are simulated in.
+  */
+
+#ifndef POLICY_H
+#define POLICY_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+struct Policy
+{
+    const char* name;
+    int powerOf2; /*Only works when k is a power of 2*/
+    int maxK; /*Most ways the state can tell apart, 0 for any k*/
+    size_t (*stateSize)(int k);
+    void (*init)(void* state, int k);
+    void (*touch)(void* state, int k, int way);
+    void (*insert)(void* state, int k, int way, uint64_t seed);
+    int (*victim)(void* state, int k, uint64_t seed);
+};
+
+const struct Policy* policyFind(const char* name);
+const char* policyNames(void);
+size_t policyStride(const struct Policy* policy, int k);
+uint64_t policySeed(uint64_t set, int64_t order);
+
+#endif
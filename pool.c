@@ -0,0 +1,651 @@
+/*pool.c
+  Work-stealing thread pool, see pool.h.
+  Every worker owns a deque of tasks. A worker takes new work from the bottom of its own deque
+  and, once that is empty, steals from the top of the deques of the other workers, so a worker
+  that drew cheap tasks (small k, small caches) keeps helping until all the work is done.
+  A task simulates one cache over whole chunks, coarse enough that each deque is simply guarded by a mutex.
+  A chunk of the trace goes back to the parser once the last cache using it is done with it.
+  */
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "pool.h"
+#include "ring.h"
+
+struct PoolTask
+{
+    void (*run)(void*);
+    void* arg;
+};
+
+struct Deque
+{
+    pthread_mutex_t lock;
+    struct PoolTask* tasks; /*Ring buffer, the tasks are tasks[top..bottom-1] modulo capacity*/
+    int capacity;
+    int top;
+    int bottom;
+};
+
+struct Pool
+{
+    int threads;
+    pthread_t* workers;
+    struct Deque* deques;
+    pthread_mutex_t lock;
+    pthread_cond_t work; /*Signalled when tasks are submitted, or the pool is destroyed*/
+    pthread_cond_t idle; /*Signalled when the last pending task finishes*/
+    int queued; /*# of tasks waiting in the deques*/
+    int pending; /*# of tasks submitted but not finished*/
+    int next; /*Deque the next task is submitted to*/
+    int stop;
+};
+
+struct Worker
+{
+    struct Pool* pool;
+    int self;
+};
+
+static void dequePush(struct Deque* dq, struct PoolTask task)
+{
+    pthread_mutex_lock(&dq->lock);
+    if (dq->bottom - dq->top == dq->capacity)
+    {
+        struct PoolTask* grown = malloc(2 * dq->capacity * sizeof(*grown));
+        int i;
+
+        if (grown == NULL)
+        {
+            perror("Could not grow a task queue");
+            exit(EXIT_FAILURE);
+        }
+        for (i = dq->top; i < dq->bottom; i++)
+        {
+            grown[i - dq->top] = dq->tasks[i % dq->capacity];
+        }
+        free(dq->tasks);
+        dq->tasks = grown;
+        dq->bottom -= dq->top;
+        dq->top = 0;
+        dq->capacity *= 2;
+    }
+    dq->tasks[dq->bottom % dq->capacity] = task;
+    dq->bottom++;
+    pthread_mutex_unlock(&dq->lock);
+}
+
+/*The owner takes the newest task, thieves the oldest one*/
+static int dequeTake(struct Deque* dq, struct PoolTask* task, int steal)
+{
+    int found = 0;
+
+    pthread_mutex_lock(&dq->lock);
+    if (dq->bottom > dq->top)
+    {
+        if (steal)
+        {
+            *task = dq->tasks[dq->top % dq->capacity];
+            dq->top++;
+        }
+        else
+        {
+            dq->bottom--;
+            *task = dq->tasks[dq->bottom % dq->capacity];
+        }
+        found = 1;
+    }
+    pthread_mutex_unlock(&dq->lock);
+    return found;
+}
+
+static int poolFind(struct Pool* pool, int self, unsigned int* seed, struct PoolTask* task)
+{
+    int i;
+    int victim;
+
+    if (dequeTake(&pool->deques[self], task, 0))
+    {
+        return 1;
+    }
+    /*Start stealing at a random victim so that idle workers do not all pile onto the same deque*/
+    *seed ^= *seed << 13;
+    *seed ^= *seed >> 17;
+    *seed ^= *seed << 5;
+    victim = (int) (*seed % (unsigned int) pool->threads);
+    for (i = 0; i < pool->threads; i++)
+    {
+        int other = (victim + i) % pool->threads;
+        if (other != self && dequeTake(&pool->deques[other], task, 1))
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static void* poolWorker(void* arg)
+{
+    struct Worker* worker = arg;
+    struct Pool* pool = worker->pool;
+    unsigned int seed = 2463534242u + (unsigned int) worker->self;
+    struct PoolTask task;
+
+    while (1)
+    {
+        pthread_mutex_lock(&pool->lock);
+        while (pool->queued == 0 && !pool->stop)
+        {
+            pthread_cond_wait(&pool->work, &pool->lock);
+        }
+        if (pool->queued == 0)
+        {
+            pthread_mutex_unlock(&pool->lock);
+            break;
+        }
+        pthread_mutex_unlock(&pool->lock);
+
+        if (!poolFind(pool, worker->self, &seed, &task))
+        {
+            sched_yield(); /*Another worker got there first, or the task is still being pushed*/
+            continue;
+        }
+
+        pthread_mutex_lock(&pool->lock);
+        pool->queued--;
+        pthread_mutex_unlock(&pool->lock);
+
+        task.run(task.arg);
+
+        pthread_mutex_lock(&pool->lock);
+        pool->pending--;
+        if (pool->pending == 0)
+        {
+            pthread_cond_broadcast(&pool->idle);
+        }
+        pthread_mutex_unlock(&pool->lock);
+    }
+    free(worker);
+    return NULL;
+}
+
+struct Pool* poolCreate(int threads)
+{
+    struct Pool* pool = calloc(1, sizeof(*pool));
+    int i;
+
+    if (pool == NULL)
+    {
+        return NULL;
+    }
+    pool->threads = threads;
+    pool->workers = calloc((size_t) threads, sizeof(*pool->workers));
+    pool->deques = calloc((size_t) threads, sizeof(*pool->deques));
+    if (pool->workers == NULL || pool->deques == NULL)
+    {
+        return NULL;
+    }
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->work, NULL);
+    pthread_cond_init(&pool->idle, NULL);
+    for (i = 0; i < threads; i++)
+    {
+        struct Worker* worker = malloc(sizeof(*worker));
+
+        pthread_mutex_init(&pool->deques[i].lock, NULL);
+        pool->deques[i].capacity = 64;
+        pool->deques[i].tasks = malloc(64 * sizeof(struct PoolTask));
+        if (worker == NULL || pool->deques[i].tasks == NULL)
+        {
+            return NULL;
+        }
+        worker->pool = pool;
+        worker->self = i;
+        if (pthread_create(&pool->workers[i], NULL, poolWorker, worker) != 0)
+        {
+            return NULL;
+        }
+    }
+    return pool;
+}
+
+/*Tasks are dealt round-robin, stealing evens out the rest*/
+void poolSubmit(struct Pool* pool, void (*run)(void*), void* arg)
+{
+    struct PoolTask task;
+
+    task.run = run;
+    task.arg = arg;
+    pthread_mutex_lock(&pool->lock);
+    pool->pending++;
+    pool->queued++;
+    pthread_mutex_unlock(&pool->lock);
+
+    dequePush(&pool->deques[pool->next], task);
+    pool->next = (pool->next + 1) % pool->threads;
+
+    pthread_mutex_lock(&pool->lock);
+    pthread_cond_signal(&pool->work);
+    pthread_mutex_unlock(&pool->lock);
+}
+
+/*Wait until every submitted task has finished*/
+void poolWait(struct Pool* pool)
+{
+    pthread_mutex_lock(&pool->lock);
+    while (pool->pending > 0)
+    {
+        pthread_cond_wait(&pool->idle, &pool->lock);
+    }
+    pthread_mutex_unlock(&pool->lock);
+}
+
+void poolDestroy(struct Pool* pool)
+{
+    int i;
+
+    pthread_mutex_lock(&pool->lock);
+    pool->stop = 1;
+    pthread_cond_broadcast(&pool->work);
+    pthread_mutex_unlock(&pool->lock);
+    for (i = 0; i < pool->threads; i++)
+    {
+        pthread_join(pool->workers[i], NULL);
+        pthread_mutex_destroy(&pool->deques[i].lock);
+        free(pool->deques[i].tasks);
+    }
+    pthread_cond_destroy(&pool->work);
+    pthread_cond_destroy(&pool->idle);
+    pthread_mutex_destroy(&pool->lock);
+    free(pool->deques);
+    free(pool->workers);
+    free(pool);
+}
+
+/*A decoded chunk of the trace*/
+struct FeedChunk
+{
+    struct TraceRecord* records;
+    int n; /*0 at the end of the trace, -1 if it could not be read*/
+    int64_t first; /*# of the access records[0] is*/
+    long long offset; /*traceOffset of records[0], -1 if the trace cannot seek*/
+    int64_t line; /*Last line read before records[0]*/
+    int users; /*# of caches still to simulate the chunk*/
+};
+
+/*The parsing stage: a thread decoding the trace into chunks, which go to the simulation through full and
+ * come back through empty, so the next chunks are parsed while the caches simulate this one*/
+struct Feed
+{
+    pthread_t thread;
+    const struct PoolInput* input;
+    struct Ring full;
+    struct Ring empty;
+    struct FeedChunk chunks[POOL_CHUNKS];
+    atomic_int stop; /*Set to end the trace early*/
+};
+
+static void* feedParser(void* arg)
+{
+    struct Feed* feed = arg;
+    const struct PoolInput* input = feed->input;
+    int64_t first = input->first;
+    int n;
+
+    do
+    {
+        struct FeedChunk* chunk = ringWaitPop(&feed->empty);
+        int max = input->chunkSize;
+
+        if (input->last >= 0 && input->last - first < max)
+        {
+            max = (int) (input->last - first + 1); /*Stop at the end of the window*/
+        }
+        if (atomic_load_explicit(&feed->stop, memory_order_relaxed))
+        {
+            max = 0;
+        }
+        chunk->offset = traceOffset(input->trace);
+        chunk->line = input->trace->line;
+        n = max > 0 ? traceRead(input->trace, chunk->records, max) : 0;
+        chunk->n = n;
+        chunk->first = first;
+        first += n;
+        ringWaitPush(&feed->full, chunk);
+    } while (n > 0);
+    return NULL;
+}
+
+static void feedStart(struct Feed* feed, const struct PoolInput* input)
+{
+    int c;
+
+    feed->input = input;
+    atomic_init(&feed->stop, 0);
+    if (ringInit(&feed->full, POOL_CHUNKS) != 0 || ringInit(&feed->empty, POOL_CHUNKS) != 0)
+    {
+        perror("Could not allocate the trace chunks");
+        exit(EXIT_FAILURE);
+    }
+    for (c = 0; c < POOL_CHUNKS; c++)
+    {
+        feed->chunks[c].records = malloc((size_t) input->chunkSize * sizeof(struct TraceRecord));
+        if (feed->chunks[c].records == NULL)
+        {
+            perror("Could not allocate the trace chunks");
+            exit(EXIT_FAILURE);
+        }
+        ringPush(&feed->empty, &feed->chunks[c]);
+    }
+    if (pthread_create(&feed->thread, NULL, feedParser, feed) != 0)
+    {
+        perror("Could not start the trace parser");
+        exit(EXIT_FAILURE);
+    }
+}
+
+/*Stop the parser after chunk, which is handed back along with anything it decoded past it*/
+static void feedCancel(struct Feed* feed, struct FeedChunk* chunk)
+{
+    atomic_store_explicit(&feed->stop, 1, memory_order_relaxed);
+    while (chunk->n > 0)
+    {
+        ringWaitPush(&feed->empty, chunk);
+        chunk = ringWaitPop(&feed->full);
+    }
+}
+
+/*Wait for the parser, which stops after handing over the last chunk*/
+static void feedStop(struct Feed* feed)
+{
+    int c;
+
+    pthread_join(feed->thread, NULL);
+    for (c = 0; c < POOL_CHUNKS; c++)
+    {
+        free(feed->chunks[c].records);
+    }
+    ringFree(&feed->full);
+    ringFree(&feed->empty);
+}
+
+/*The chunks of poolRunTrace the caches may still be simulating*/
+struct ChunkWindow
+{
+    pthread_mutex_t lock;
+    struct Feed* feed;
+    struct FeedChunk* chunks[POOL_CHUNKS]; /*Chunk # c is chunks[c % POOL_CHUNKS]*/
+    long posted; /*# of chunks handed to the caches so far*/
+};
+
+/*Where one cache is in the window*/
+struct ChunkCursor
+{
+    struct ChunkWindow* window;
+    ChunkFunction run;
+    void* sim;
+    long next; /*# of the next chunk the cache simulates*/
+    int busy; /*A task is working through the chunks for the cache*/
+};
+
+/*Simulate the cache of cursor over every chunk posted so far, then let the next chunk start a new task*/
+static void runCursor(void* arg)
+{
+    struct ChunkCursor* cursor = arg;
+    struct ChunkWindow* window = cursor->window;
+    struct FeedChunk* chunk;
+
+    pthread_mutex_lock(&window->lock);
+    while (cursor->next < window->posted)
+    {
+        chunk = window->chunks[cursor->next % POOL_CHUNKS];
+        pthread_mutex_unlock(&window->lock);
+
+        cursor->run(cursor->sim, chunk->records, chunk->n, chunk->first);
+
+        pthread_mutex_lock(&window->lock);
+        cursor->next++;
+        if (--chunk->users == 0)
+        {
+            /*The lock makes the workers a single producer, and the ring holds every chunk, so this never waits*/
+            ringWaitPush(&window->feed->empty, chunk);
+        }
+    }
+    cursor->busy = 0;
+    pthread_mutex_unlock(&window->lock);
+}
+
+/*Run every cache in sims over the trace of input, decoded on a thread of its own.
+ * With a pool, each cache works through the chunks in a task of its own, so the caches run ahead of each other
+ * by up to POOL_CHUNKS chunks. They all catch up before a mark, which may look at them. Without a pool they
+ * take turns on each chunk. A cache is only ever touched by one task at a time, so it needs no locking.
+ * Returns the # of the first access not simulated, or -1 if line trace->line could not be read*/
+int64_t poolRunTrace(struct Pool* pool, const struct PoolInput* input, void** sims, int nsims, ChunkFunction run)
+{
+    struct Feed feed;
+    struct FeedChunk* chunk;
+    struct ChunkWindow window;
+    struct ChunkCursor* cursors;
+    int64_t next;
+    int n;
+    int i;
+
+    cursors = calloc((size_t) nsims, sizeof(*cursors));
+    if (cursors == NULL)
+    {
+        perror("Could not allocate the trace chunks");
+        exit(EXIT_FAILURE);
+    }
+    pthread_mutex_init(&window.lock, NULL);
+    window.feed = &feed;
+    window.posted = 0;
+    for (i = 0; i < nsims; i++)
+    {
+        cursors[i].window = &window;
+        cursors[i].run = run;
+        cursors[i].sim = sims[i];
+    }
+    feedStart(&feed, input);
+
+    next = input->first;
+    while ((n = (chunk = ringWaitPop(&feed.full))->n) > 0)
+    {
+        if (input->mark != NULL)
+        {
+            if (pool != NULL)
+            {
+                poolWait(pool);
+            }
+            if (input->mark(input->markArg, chunk->first, chunk->offset, chunk->line) != 0)
+            {
+                feedCancel(&feed, chunk);
+                break;
+            }
+        }
+        next = chunk->first + chunk->n;
+        if (pool == NULL)
+        {
+            for (i = 0; i < nsims; i++)
+            {
+                run(sims[i], chunk->records, chunk->n, chunk->first);
+            }
+            ringWaitPush(&feed.empty, chunk);
+            continue;
+        }
+
+        chunk->users = nsims;
+        pthread_mutex_lock(&window.lock);
+        window.chunks[window.posted % POOL_CHUNKS] = chunk;
+        window.posted++;
+        for (i = 0; i < nsims; i++)
+        {
+            if (!cursors[i].busy)
+            {
+                cursors[i].busy = 1;
+                poolSubmit(pool, runCursor, &cursors[i]);
+            }
+        }
+        pthread_mutex_unlock(&window.lock);
+    }
+    if (pool != NULL)
+    {
+        poolWait(pool);
+    }
+
+    feedStop(&feed);
+    pthread_mutex_destroy(&window.lock);
+    free(cursors);
+    return n < 0 ? -1 : next;
+}
+
+struct PartAccess
+{
+    struct TraceRecord record;
+    int64_t order;
+};
+
+struct PartBatch
+{
+    int n; /*0 marks the end of the trace*/
+    struct PartAccess accesses[PART_BATCH];
+};
+
+/*Batches go to the worker through full and come back empty through empty*/
+struct PartWorker
+{
+    pthread_t thread;
+    void* sim;
+    AccessFunction access;
+    struct Ring full;
+    struct Ring empty;
+    struct PartBatch* batches;
+};
+
+static void* partWorker(void* arg)
+{
+    struct PartWorker* worker = arg;
+
+    while (1)
+    {
+        struct PartBatch* batch = ringWaitPop(&worker->full);
+        int j;
+
+        if (batch->n == 0)
+        {
+            break;
+        }
+        for (j = 0; j < batch->n; j++)
+        {
+            worker->access(worker->sim, &batch->accesses[j].record, batch->accesses[j].order);
+        }
+        ringWaitPush(&worker->empty, batch);
+    }
+    return NULL;
+}
+
+/*Run a single cache over the whole trace on workers threads. parts[w] is the cache as seen by worker w:
+ * all of them share the cache lines, but each has its own statistics. Worker w owns the sets
+ * [w*sets/workers, (w+1)*sets/workers), so no two workers ever touch the same set.
+ * Returns the # of the first access not simulated, or -1 if line trace->line could not be read*/
+int64_t poolRunPartitioned(const struct PoolInput* input, void** parts, int workers, int offset_size, int index_size,
+                           AccessFunction access)
+{
+    struct PartWorker* pw = calloc((size_t) workers, sizeof(*pw));
+    struct PartBatch** current = calloc((size_t) workers, sizeof(*current));
+    struct Feed feed;
+    struct FeedChunk* chunk;
+    uint64_t setMask = (UINT64_C(1) << index_size) - 1;
+    int64_t next = input->first;
+    int n;
+    int w;
+
+    if (pw == NULL || current == NULL)
+    {
+        perror("Could not allocate the set-partition workers");
+        exit(EXIT_FAILURE);
+    }
+    for (w = 0; w < workers; w++)
+    {
+        int b;
+
+        pw[w].sim = parts[w];
+        pw[w].access = access;
+        pw[w].batches = malloc(PART_BATCHES * sizeof(struct PartBatch));
+        if (pw[w].batches == NULL || ringInit(&pw[w].full, PART_BATCHES) != 0
+            || ringInit(&pw[w].empty, PART_BATCHES) != 0)
+        {
+            perror("Could not allocate the set-partition workers");
+            exit(EXIT_FAILURE);
+        }
+        for (b = 1; b < PART_BATCHES; b++)
+        {
+            ringPush(&pw[w].empty, &pw[w].batches[b]);
+        }
+        current[w] = &pw[w].batches[0];
+        current[w]->n = 0;
+        if (pthread_create(&pw[w].thread, NULL, partWorker, &pw[w]) != 0)
+        {
+            perror("Could not start the worker threads");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    feedStart(&feed, input);
+    while ((n = (chunk = ringWaitPop(&feed.full))->n) > 0)
+    {
+        int j;
+
+        if (input->mark != NULL && input->mark(input->markArg, chunk->first, chunk->offset, chunk->line) != 0)
+        {
+            feedCancel(&feed, chunk);
+            break;
+        }
+        for (j = 0; j < chunk->n; j++)
+        {
+            uint64_t set = (chunk->records[j].mem >> offset_size) & setMask;
+            struct PartBatch* batch;
+
+            w = (int) ((set * (uint64_t) workers) >> index_size);
+            batch = current[w];
+            batch->accesses[batch->n].record = chunk->records[j];
+            batch->accesses[batch->n].order = chunk->first + j;
+            batch->n++;
+            if (batch->n == PART_BATCH)
+            {
+                ringWaitPush(&pw[w].full, batch);
+                current[w] = ringWaitPop(&pw[w].empty);
+                current[w]->n = 0;
+            }
+        }
+        next = chunk->first + chunk->n;
+        ringWaitPush(&feed.empty, chunk);
+    }
+    feedStop(&feed);
+
+    /*Hand over what is left, then an empty batch to stop each worker*/
+    for (w = 0; w < workers; w++)
+    {
+        if (current[w]->n > 0)
+        {
+            ringWaitPush(&pw[w].full, current[w]);
+            current[w] = ringWaitPop(&pw[w].empty);
+            current[w]->n = 0;
+        }
+        ringWaitPush(&pw[w].full, current[w]);
+    }
+    for (w = 0; w < workers; w++)
+    {
+        pthread_join(pw[w].thread, NULL);
+        ringFree(&pw[w].full);
+        ringFree(&pw[w].empty);
+        free(pw[w].batches);
+    }
+
+    free(pw);
+    free(current);
+    return n < 0 ? -1 : next;
+}
@@ -0,0 +1,53 @@
+/*pool.h
+  Work-stealing thread pool, and the driver that runs the caches of a sweep over a trace.
+  The trace is decoded once into chunks of TraceRecords, on a thread of its own that runs up to POOL_CHUNKS
+  chunks ahead of the simulation over a single-producer/single-consumer ring (see ring.h), so parsing and
+  simulating overlap even without a pool. With a pool, every cache of the sweep works through the chunks in
+  order in a task of its own, so a fast cache runs up to POOL_CHUNKS chunks ahead of the slowest one instead of
+  waiting for it at the end of every chunk.
+  A single cache can instead be split by set: each worker owns a contiguous range of sets and
+  the main thread routes every access to the owner of its set, so per-set access order is unchanged.
+  */
+
+#ifndef POOL_H
+#define POOL_H
+
+#include <stdint.h>
+
+#include "trace.h"
+
+#define POOL_CHUNK 16384 /*Default # of accesses per chunk of the decoded trace*/
+#define POOL_CHUNKS 4 /*# of decoded chunks in flight, a power of 2*/
+#define PART_BATCH 4096 /*# of accesses routed to a set-partition worker at a time*/
+#define PART_BATCHES 8 /*# of batches in flight per set-partition worker*/
+
+struct Pool;
+
+/*The part of a trace to simulate, and how to read it*/
+struct PoolInput
+{
+    struct TraceReader* trace;
+    int chunkSize; /*# of accesses per decoded chunk*/
+    int64_t first; /*# of the next access of trace, which is not 0 if it was seeked into*/
+    int64_t last; /*# of the last access to simulate, -1 for the whole trace*/
+    /*Called with the position of each chunk before it is simulated, NULL for none. A nonzero return stops
+     * the run before the chunk. poolRunPartitioned calls it while earlier chunks may still be simulating*/
+    int (*mark)(void* arg, int64_t first, long long offset, int64_t line);
+    void* markArg;
+};
+
+/*Simulate records[0..n-1] of the trace, the first of which is access # first*/
+typedef void (*ChunkFunction)(void* sim, const struct TraceRecord* records, int n, int64_t first);
+/*Simulate one record of the trace, which is access # order*/
+typedef void (*AccessFunction)(void* sim, const struct TraceRecord* record, int64_t order);
+
+struct Pool* poolCreate(int threads);
+void poolSubmit(struct Pool* pool, void (*run)(void*), void* arg);
+void poolWait(struct Pool* pool);
+void poolDestroy(struct Pool* pool);
+
+int64_t poolRunTrace(struct Pool* pool, const struct PoolInput* input, void** sims, int nsims, ChunkFunction run);
+int64_t poolRunPartitioned(const struct PoolInput* input, void** parts, int workers, int offset_size, int index_size,
+                           AccessFunction access);
+
+#endif
@@ -0,0 +1,330 @@
+/*prefetch.c
+  Hardware prefetchers, see prefetch.h.
+  */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "prefetch.h"
+
+const char* const prefetchNames[PREFETCH_KINDS] = {"next", "stride", "stream"};
+
+/*Degree of each kind when none is given*/
+static const int prefetchDegrees[PREFETCH_KINDS] = {1, 4, 4};
+
+/*Returns -1 if name is not a prefetcher*/
+int prefetchKind(const char* name, enum PrefetchKind* kind)
+{
+    int p;
+
+    for (p = 0; p < PREFETCH_KINDS; p++)
+    {
+        if (strcmp(name, prefetchNames[p]) == 0)
+        {
+            *kind = (enum PrefetchKind) p;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+/*Prefetch into cache, degree blocks at a time (0 for the default of kind). Returns -1 if degree is not
+ * 0 .. PREFETCH_DEGREE_MAX or the prefetcher could not be allocated*/
+int prefetchInit(struct Prefetcher* prefetcher, const struct Cache* cache, enum PrefetchKind kind, int degree)
+{
+    size_t lines = (size_t) cache->sets * cache->k;
+    size_t i;
+    int s;
+
+    memset(prefetcher, 0, sizeof(*prefetcher));
+    if (degree < 0 || degree > PREFETCH_DEGREE_MAX)
+    {
+        return -1;
+    }
+    prefetcher->kind = kind;
+    prefetcher->degree = degree != 0 ? degree : prefetchDegrees[kind];
+    prefetcher->offset_size = cache->offset_size;
+    prefetcher->blockSize = (unsigned long) cache->blockSize;
+    prefetcher->blocks = malloc(lines * sizeof(*prefetcher->blocks));
+    prefetcher->arrivals = malloc(lines * sizeof(*prefetcher->arrivals));
+    prefetcher->victims = malloc(PREFETCH_VICTIMS * sizeof(*prefetcher->victims));
+    if (prefetcher->blocks == NULL || prefetcher->arrivals == NULL || prefetcher->victims == NULL)
+    {
+        prefetchFree(prefetcher);
+        return -1;
+    }
+    for (i = 0; i < lines; i++)
+    {
+        prefetcher->blocks[i] = UINT64_MAX;
+    }
+    for (i = 0; i < PREFETCH_VICTIMS; i++)
+    {
+        prefetcher->victims[i] = UINT64_MAX;
+    }
+    for (s = 0; s < PREFETCH_STRIDES; s++)
+    {
+        prefetcher->strides[s].pc = UINT64_MAX;
+    }
+    return 0;
+}
+
+static uint64_t* victimSlot(struct Prefetcher* prefetcher, uint64_t block)
+{
+    return &prefetcher->victims[((block * UINT64_C(0x9E3779B97F4A7C15)) >> 32) & (PREFETCH_VICTIMS - 1)];
+}
+
+/*Prefetch the block of MEM into the cache, unless it is there already*/
+static void prefetchIssue(struct Prefetcher* prefetcher, struct Cache* cache, uint64_t MEM, int64_t order)
+{
+    uint64_t block = MEM >> prefetcher->offset_size;
+    uint64_t victim;
+    uint64_t* slot;
+    int dirty;
+    int line;
+
+    line = cacheFill(cache, MEM, order, &victim, &dirty);
+    if (line == -1)
+    {
+        return;
+    }
+    prefetcher->blocks[line] = block;
+    prefetcher->arrivals[line] = prefetcher->clock + CACHE_MISS_PENALTY;
+    prefetcher->stats.issued++;
+    prefetcher->stats.bytesRead += prefetcher->blockSize;
+    if (dirty)
+    {
+        prefetcher->stats.bytesWritten += prefetcher->blockSize;
+    }
+
+    slot = victimSlot(prefetcher, block);
+    if (*slot == block)
+    {
+        *slot = UINT64_MAX; /*Back in the cache before it missed*/
+    }
+    if (victim != UINT64_MAX)
+    {
+        *victimSlot(prefetcher, victim >> prefetcher->offset_size) = victim >> prefetcher->offset_size;
+    }
+}
+
+/*Fetch blocks into the end of stream until it holds degree of them*/
+static void streamFetch(struct Prefetcher* prefetcher, struct PrefetchStream* stream)
+{
+    while (stream->count < prefetcher->degree)
+    {
+        stream->arrivals[(stream->head + (uint64_t) stream->count) % PREFETCH_DEGREE_MAX] =
+            prefetcher->clock + CACHE_MISS_PENALTY;
+        stream->count++;
+        prefetcher->stats.issued++;
+        prefetcher->stats.bytesRead += prefetcher->blockSize;
+    }
+}
+
+/*If the block of MEM is about to miss but is in a stream buffer, move it into the cache, dropping the blocks
+ * before it, and top the buffer up. Returns 1 then, with *arrival set to when the block arrives*/
+static int streamTake(struct Prefetcher* prefetcher, struct Cache* cache, uint64_t MEM, int64_t order,
+                      uint64_t* arrival)
+{
+    uint64_t block = MEM >> prefetcher->offset_size;
+    int s;
+
+    if (cacheProbe(cache, MEM) != -1)
+    {
+        return 0;
+    }
+    for (s = 0; s < PREFETCH_STREAMS; s++)
+    {
+        struct PrefetchStream* stream = &prefetcher->streams[s];
+
+        if (block - stream->head < (uint64_t) stream->count)
+        {
+            uint64_t victim;
+            int dirty;
+
+            *arrival = stream->arrivals[block % PREFETCH_DEGREE_MAX];
+            cacheFill(cache, MEM, order, &victim, &dirty);
+            if (dirty)
+            {
+                prefetcher->stats.bytesWritten += prefetcher->blockSize;
+            }
+            stream->count -= (int) (block - stream->head) + 1;
+            stream->head = block + 1;
+            stream->lastUsed = order;
+            streamFetch(prefetcher, stream);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/*Point the least recently used stream buffer at the blocks after block*/
+static void streamAllocate(struct Prefetcher* prefetcher, uint64_t block, int64_t order)
+{
+    struct PrefetchStream* stream = &prefetcher->streams[0];
+    int s;
+
+    for (s = 1; s < PREFETCH_STREAMS; s++)
+    {
+        if (prefetcher->streams[s].lastUsed < stream->lastUsed)
+        {
+            stream = &prefetcher->streams[s];
+        }
+    }
+    stream->head = block + 1;
+    stream->count = 0;
+    stream->lastUsed = order;
+    streamFetch(prefetcher, stream);
+}
+
+/*Learn the stride of the instruction of record, and prefetch degree strides ahead once it repeats.
+ * Strides smaller than a block step a block at a time*/
+static void strideTrain(struct Prefetcher* prefetcher, struct Cache* cache, const struct TraceRecord* record,
+                        int64_t order)
+{
+    uint64_t pc = record->pc & TRACE_PC_MASK;
+    struct PrefetchStride* entry = &prefetcher->strides[(pc >> 2) & (PREFETCH_STRIDES - 1)];
+    int64_t step;
+    int64_t stride;
+    int i;
+
+    if (entry->pc != pc)
+    {
+        entry->pc = pc;
+        entry->last = record->mem;
+        entry->stride = 0;
+        entry->repeated = 0;
+        return;
+    }
+    stride = (int64_t) (record->mem - entry->last);
+    entry->last = record->mem;
+    entry->repeated = stride == entry->stride;
+    entry->stride = stride;
+    if (!entry->repeated || stride == 0)
+    {
+        return;
+    }
+
+    step = stride;
+    if (step > -(int64_t) prefetcher->blockSize && step < (int64_t) prefetcher->blockSize)
+    {
+        step = stride > 0 ? (int64_t) prefetcher->blockSize : -(int64_t) prefetcher->blockSize;
+    }
+    for (i = 1; i <= prefetcher->degree; i++)
+    {
+        prefetchIssue(prefetcher, cache, record->mem + (uint64_t) (step * i), order);
+    }
+}
+
+/*Simulate record, access # order, on cache with prefetching. Returns the cycles the cache took for it, which
+ * do not include any wait for a late prefetch*/
+unsigned long prefetchAccess(struct Prefetcher* prefetcher, struct Cache* cache, const struct TraceRecord* record,
+                             int64_t order, struct CacheStats* stats)
+{
+    uint64_t block = record->mem >> prefetcher->offset_size;
+    unsigned long cycles = stats->readCycles + stats->writeCycles;
+    unsigned long wait = 0;
+    uint64_t arrival = 0;
+    int used = 0; /*The access uses a prefetched block for the first time*/
+    int line;
+    int i;
+
+    if (prefetcher->kind == PREFETCH_STREAM)
+    {
+        used = streamTake(prefetcher, cache, record->mem, order, &arrival);
+    }
+    else if ((line = cacheProbe(cache, record->mem)) != -1 && prefetcher->blocks[line] == block)
+    {
+        used = 1;
+        arrival = prefetcher->arrivals[line];
+        prefetcher->blocks[line] = UINT64_MAX;
+    }
+    if (used)
+    {
+        wait = arrival > prefetcher->clock ? (unsigned long) (arrival - prefetcher->clock) : 0;
+        prefetcher->stats.useful++;
+        prefetcher->stats.late += wait > 0;
+        prefetcher->stats.lateCycles += wait;
+        prefetcher->stats.hiddenCycles += CACHE_MISS_PENALTY - wait;
+    }
+
+    cacheAccess(cache, traceOp(record), record->mem, order, stats);
+    cycles = stats->readCycles + stats->writeCycles - cycles;
+    if (cycles > 1)
+    {
+        uint64_t* slot = victimSlot(prefetcher, block);
+
+        if (*slot == block)
+        {
+            prefetcher->stats.polluting++;
+            *slot = UINT64_MAX;
+        }
+        /*The line it went in may still be marked for a block prefetched into it before*/
+        line = cacheProbe(cache, record->mem);
+        if (line != -1 && prefetcher->kind != PREFETCH_STREAM)
+        {
+            prefetcher->blocks[line] = UINT64_MAX;
+        }
+    }
+    if (traceOp(record) == 'S')
+    {
+        stats->writeCycles += wait;
+    }
+    else
+    {
+        stats->readCycles += wait;
+    }
+    prefetcher->clock += cycles + wait;
+
+    switch (prefetcher->kind)
+    {
+    case PREFETCH_NEXT:
+        if (cycles > 1 || used)
+        {
+            for (i = 1; i <= prefetcher->degree; i++)
+            {
+                prefetchIssue(prefetcher, cache, (block + (uint64_t) i) << prefetcher->offset_size, order);
+            }
+        }
+        break;
+    case PREFETCH_STRIDE:
+        strideTrain(prefetcher, cache, record, order);
+        break;
+    default:
+        if (cycles > 1)
+        {
+            streamAllocate(prefetcher, block, order);
+        }
+        break;
+    }
+    return cycles;
+}
+
+void prefetchPrint(const struct Prefetcher* prefetcher, const struct CacheStats* stats)
+{
+    const struct PrefetchStats* p = &prefetcher->stats;
+    double accuracy = p->issued > 0 ? (double) p->useful / p->issued : 0.0;
+    double coverage = p->useful + stats->dataMisses > 0 ? (double) p->useful / (p->useful + stats->dataMisses) : 0.0;
+
+    printf("\nprefetcher = %s, degree = %d\n", prefetchNames[prefetcher->kind], prefetcher->degree);
+    printf("number of prefetches = %lu\n", p->issued);
+    printf("number of useful prefetches = %lu\n", p->useful);
+    printf("number of late prefetches = %lu\n", p->late);
+    printf("number of polluting prefetches = %lu\n", p->polluting);
+    printf("number of bytes read by prefetches = %lu\n", p->bytesRead);
+    printf("number of bytes written by prefetches = %lu\n", p->bytesWritten);
+    printf("miss cycles hidden by prefetches = %lu\n", p->hiddenCycles);
+    printf("cycles waited for late prefetches = %lu\n", p->lateCycles);
+    printf("prefetch accuracy = %f\n", accuracy);
+    printf("prefetch coverage = %f\n", coverage);
+}
+
+void prefetchFree(struct Prefetcher* prefetcher)
+{
+    free(prefetcher->blocks);
+    free(prefetcher->arrivals);
+    free(prefetcher->victims);
+    prefetcher->blocks = NULL;
+    prefetcher->arrivals = NULL;
+    prefetcher->victims = NULL;
+}
@@ -0,0 +1,93 @@
+/*prefetch.h
+  Hardware prefetchers for a cache of cachesim.c. A Prefetcher sees every demand access of its cache and brings
+  blocks in ahead of them, degree blocks at a time:
+    next    tagged next-line: a miss, or the first use of a prefetched block, prefetches the blocks after it
+    stride  a table of PREFETCH_STRIDES entries indexed by the PC learns the stride of each load and store, and once
+            an instruction repeats its stride prefetches that many strides ahead (at least a block each)
+    stream  PREFETCH_STREAMS stream buffers. A miss in no buffer points the least recently used one at the blocks
+            after it, and a miss on a block in a buffer moves that block into the cache and tops the buffer up
+  The next-line and stride prefetchers fill the cache itself, the stream buffers hold their blocks on the side, so
+  they never evict a block that is not about to be used.
+  Time is the cycles of the demand accesses so far, and a prefetch arrives CACHE_MISS_PENALTY cycles after it is
+  issued, however many are in flight. A prefetched block that a demand access uses is useful, and late if it has
+  not arrived yet, in which case the access waits for it: the wait is added to the cycles of the CacheStats, on
+  top of the hit. A prefetch is polluting if the block it evicted misses again before anything else evicts it, as
+  recorded in a table of the last PREFETCH_VICTIMS victims. The accuracy is the fraction of the prefetches that were
+  useful, the coverage the fraction of the would-be misses that useful prefetches removed.
+  */
+
+#ifndef PREFETCH_H
+#define PREFETCH_H
+
+#include <stdint.h>
+
+#include "cachesim.h"
+#include "trace.h"
+
+#define PREFETCH_DEGREE_MAX 16
+#define PREFETCH_STRIDES 256 /*Entries of the stride table, a power of 2*/
+#define PREFETCH_STREAMS 4
+#define PREFETCH_VICTIMS 4096 /*Entries of the table of evicted blocks, a power of 2*/
+
+enum PrefetchKind
+{
+    PREFETCH_NEXT,
+    PREFETCH_STRIDE,
+    PREFETCH_STREAM,
+    PREFETCH_KINDS
+};
+
+struct PrefetchStats
+{
+    unsigned long issued; /*Blocks fetched from memory by prefetches*/
+    unsigned long useful; /*Prefetched blocks used by a demand access*/
+    unsigned long late; /*Useful prefetches that had not arrived when they were used*/
+    unsigned long polluting;
+    unsigned long bytesRead;
+    unsigned long bytesWritten; /*Write-backs of the dirty blocks prefetched blocks evicted*/
+    unsigned long hiddenCycles; /*Miss cycles the useful prefetches saved*/
+    unsigned long lateCycles; /*Cycles the demand accesses waited for late prefetches*/
+};
+
+struct PrefetchStride
+{
+    uint64_t pc;
+    uint64_t last; /*Address of the last access of pc*/
+    int64_t stride;
+    int repeated; /*The last two strides of pc were the same*/
+};
+
+/*Blocks head .. head + count - 1, each arriving at arrivals[block % PREFETCH_DEGREE_MAX]*/
+struct PrefetchStream
+{
+    uint64_t head;
+    int count;
+    int64_t lastUsed; /*# of the access that last used the buffer*/
+    uint64_t arrivals[PREFETCH_DEGREE_MAX];
+};
+
+struct Prefetcher
+{
+    enum PrefetchKind kind;
+    int degree;
+    int offset_size; /*log2 of the block size*/
+    unsigned long blockSize;
+    uint64_t clock; /*Cycles of the demand accesses so far*/
+    uint64_t* blocks; /*Block each line of the cache was prefetched into it for, UINT64_MAX once used*/
+    uint64_t* arrivals; /*When it arrives*/
+    uint64_t* victims; /*Blocks evicted by prefetches, by a hash of the block*/
+    struct PrefetchStride strides[PREFETCH_STRIDES];
+    struct PrefetchStream streams[PREFETCH_STREAMS];
+    struct PrefetchStats stats;
+};
+
+extern const char* const prefetchNames[PREFETCH_KINDS];
+
+int prefetchKind(const char* name, enum PrefetchKind* kind);
+int prefetchInit(struct Prefetcher* prefetcher, const struct Cache* cache, enum PrefetchKind kind, int degree);
+unsigned long prefetchAccess(struct Prefetcher* prefetcher, struct Cache* cache, const struct TraceRecord* record,
+                             int64_t order, struct CacheStats* stats);
+void prefetchPrint(const struct Prefetcher* prefetcher, const struct CacheStats* stats);
+void prefetchFree(struct Prefetcher* prefetcher);
+
+#endif
@@ -0,0 +1,170 @@
+/*ring.h
+  Lock-free single-producer/single-consumer ring of pointers.
+  The producer only writes tail and the consumer only writes head, each on its own host cache line,
+  so passing an item costs one release store and one acquire load on each side, plus a fence and a load to see
+  whether the other side is asleep. A side that has to wait spins for a while, then sleeps on a condition variable
+  until the other side moves, so an idle writer or parser thread does not keep a core busy.
+  */
+
+#ifndef RING_H
+#define RING_H
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+
+#define RING_SPINS 64 /*# of times a blocking push or pop yields the core before it sleeps*/
+
+struct Ring
+{
+    _Alignas(64) atomic_size_t head; /*Next slot the consumer reads*/
+    _Alignas(64) atomic_size_t tail; /*Next slot the producer writes*/
+    _Alignas(64) size_t mask; /*capacity - 1, capacity is a power of 2*/
+    void** slots;
+    _Alignas(64) atomic_int sleepers; /*# of sides asleep on wake*/
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+};
+
+static inline int ringInit(struct Ring* ring, size_t capacity)
+{
+    atomic_init(&ring->head, 0);
+    atomic_init(&ring->tail, 0);
+    atomic_init(&ring->sleepers, 0);
+    ring->mask = capacity - 1;
+    ring->slots = malloc(capacity * sizeof(void*));
+    if (ring->slots == NULL)
+    {
+        return -1;
+    }
+    pthread_mutex_init(&ring->lock, NULL);
+    pthread_cond_init(&ring->wake, NULL);
+    return 0;
+}
+
+static inline void ringFree(struct Ring* ring)
+{
+    if (ring->slots != NULL)
+    {
+        pthread_mutex_destroy(&ring->lock);
+        pthread_cond_destroy(&ring->wake);
+    }
+    free(ring->slots);
+    ring->slots = NULL;
+}
+
+/*Wake the other side if it sleeps. The fence orders the move just made before the look at sleepers,
+ * as ringSleep orders its own count before its last try*/
+static inline void ringNotify(struct Ring* ring)
+{
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_load_explicit(&ring->sleepers, memory_order_relaxed) != 0)
+    {
+        pthread_mutex_lock(&ring->lock);
+        pthread_cond_broadcast(&ring->wake);
+        pthread_mutex_unlock(&ring->lock);
+    }
+}
+
+static inline int ringTryPush(struct Ring* ring, void* item)
+{
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+
+    if (tail - atomic_load_explicit(&ring->head, memory_order_acquire) > ring->mask)
+    {
+        return 0;
+    }
+    ring->slots[tail & ring->mask] = item;
+    atomic_store_explicit(&ring->tail, tail + 1, memory_order_release);
+    return 1;
+}
+
+static inline void* ringTryPop(struct Ring* ring)
+{
+    size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    void* item;
+
+    if (head == atomic_load_explicit(&ring->tail, memory_order_acquire))
+    {
+        return NULL;
+    }
+    item = ring->slots[head & ring->mask];
+    atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+    return item;
+}
+
+/*Returns 0 if the ring is full*/
+static inline int ringPush(struct Ring* ring, void* item)
+{
+    if (!ringTryPush(ring, item))
+    {
+        return 0;
+    }
+    ringNotify(ring);
+    return 1;
+}
+
+/*Returns NULL if the ring is empty*/
+static inline void* ringPop(struct Ring* ring)
+{
+    void* item = ringTryPop(ring);
+
+    if (item != NULL)
+    {
+        ringNotify(ring);
+    }
+    return item;
+}
+
+/*Sleep until a push of item (pop if item is NULL) goes through, and return what it popped*/
+static inline void* ringSleep(struct Ring* ring, void* item)
+{
+    void* popped = NULL;
+
+    pthread_mutex_lock(&ring->lock);
+    atomic_fetch_add(&ring->sleepers, 1);
+    atomic_thread_fence(memory_order_seq_cst);
+    while (item != NULL ? !ringTryPush(ring, item) : (popped = ringTryPop(ring)) == NULL)
+    {
+        pthread_cond_wait(&ring->wake, &ring->lock);
+    }
+    atomic_fetch_sub(&ring->sleepers, 1);
+    pthread_cond_broadcast(&ring->wake); /*The other side may be asleep too, waiting for this move*/
+    pthread_mutex_unlock(&ring->lock);
+    return popped;
+}
+
+/*Blocking versions, which give the core away RING_SPINS times, then sleep*/
+static inline void ringWaitPush(struct Ring* ring, void* item)
+{
+    int spins;
+
+    for (spins = 0; !ringPush(ring, item); spins++)
+    {
+        if (spins == RING_SPINS)
+        {
+            ringSleep(ring, item);
+            return;
+        }
+        sched_yield();
+    }
+}
+
+static inline void* ringWaitPop(struct Ring* ring)
+{
+    void* item;
+    int spins;
+
+    for (spins = 0; (item = ringPop(ring)) == NULL; spins++)
+    {
+        if (spins == RING_SPINS)
+        {
+            return ringSleep(ring, NULL);
+        }
+        sched_yield();
+    }
+    return item;
+}
+
+#endif
@@ -0,0 +1,174 @@
+/*sample.c
+  Set sampling, see sample.h.
+  */
+
+#include <math.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sample.h"
+
+/*Two-sided 95% quantiles of Student's t distribution, by degrees of freedom - 1*/
+static const double tQuantile[SAMPLE_GROUPS - 1] = {12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306,
+                                                     2.262, 2.228, 2.201, 2.179, 2.160, 2.145, 2.131};
+
+static const size_t statFields[] = {
+    offsetof(struct CacheStats, dataAccesses), offsetof(struct CacheStats, dataReads),
+    offsetof(struct CacheStats, dataWrites),   offsetof(struct CacheStats, dataMisses),
+    offsetof(struct CacheStats, readMisses),   offsetof(struct CacheStats, writeMisses),
+    offsetof(struct CacheStats, dReadMisses),  offsetof(struct CacheStats, dWriteMisses),
+    offsetof(struct CacheStats, bytesRead),    offsetof(struct CacheStats, bytesWritten),
+    offsetof(struct CacheStats, readCycles),   offsetof(struct CacheStats, writeCycles)};
+
+#define STAT(stats, field) (*(unsigned long*) ((char*) (stats) + (field)))
+
+/*splitmix64 finalizer, so that neighbouring sets land in unrelated groups*/
+static uint64_t sampleHash(uint64_t set)
+{
+    set += 0x9E3779B97F4A7C15ULL;
+    set = (set ^ (set >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    set = (set ^ (set >> 27)) * 0x94D049BB133111EBULL;
+    return set ^ (set >> 31);
+}
+
+/*Sample about rate (0 < rate <= 1) of the sets of cache. Returns -1 if fewer than 2 groups got a set,
+ * too few to estimate a confidence interval from, in which case the cache is better simulated exactly*/
+int sampleInit(struct CacheSample* sample, const struct Cache* cache, double rate)
+{
+    uint64_t threshold = rate >= 1.0 ? UINT64_C(1) << 32 : (uint64_t) (rate * 4294967296.0);
+    int groups = 0;
+    int g;
+    int s;
+
+    memset(sample, 0, sizeof(*sample));
+    sample->rate = rate;
+    sample->groups = malloc((size_t) cache->sets);
+    if (sample->groups == NULL)
+    {
+        return -1;
+    }
+    for (s = 0; s < cache->sets; s++)
+    {
+        uint64_t hash = sampleHash((uint64_t) s);
+
+        sample->groups[s] = SAMPLE_NONE;
+        if ((hash >> 32) < threshold)
+        {
+            sample->groups[s] = (uint8_t) (hash % SAMPLE_GROUPS);
+            sample->groupSets[sample->groups[s]]++;
+            sample->sampledSets++;
+        }
+    }
+    for (g = 0; g < SAMPLE_GROUPS; g++)
+    {
+        groups += sample->groupSets[g] > 0;
+    }
+    if (groups < 2)
+    {
+        sampleFree(sample);
+        return -1;
+    }
+    return 0;
+}
+
+/*Simulate the accesses of records[0..n-1] that map to a sampled set, the first record being access # first*/
+void sampleRun(struct CacheSample* sample, struct Cache* cache, const struct TraceRecord* records, int n,
+               int64_t first)
+{
+    uint64_t setMask = (uint64_t) cache->sets - 1;
+    int j;
+
+    for (j = 0; j < n; j++)
+    {
+        uint8_t g = sample->groups[(records[j].mem >> cache->offset_size) & setMask];
+
+        if (g != SAMPLE_NONE)
+        {
+            cacheAccess(cache, traceOp(&records[j]), records[j].mem, first + j, &sample->stats[g]);
+        }
+    }
+}
+
+/*Margin of a 95% confidence interval from the estimates of n groups, given their sum and sum of squares*/
+static double sampleMargin(double sum, double squares, int n, double correction)
+{
+    double variance;
+
+    if (n < 2)
+    {
+        return 0.0;
+    }
+    variance = (squares - sum * sum / n) / (n - 1);
+    return variance > 0.0 ? tQuantile[n - 2] * sqrt(variance / n * correction) : 0.0;
+}
+
+void sampleEstimate(const struct CacheSample* sample, const struct Cache* cache, struct SampleEstimate* estimate)
+{
+    double scale = (double) cache->sets / sample->sampledSets;
+    double correction = 1.0 - (double) sample->sampledSets / cache->sets; /*Finite population correction*/
+    struct CacheStats sum;
+    double residualSum = 0.0;
+    double residualSquares = 0.0;
+    int groups = 0;
+    size_t f;
+    int g;
+
+    memset(&sum, 0, sizeof(sum));
+    memset(estimate, 0, sizeof(*estimate));
+    for (g = 0; g < SAMPLE_GROUPS; g++)
+    {
+        cacheStatsAdd(&sum, &sample->stats[g]);
+    }
+
+    /*The miss rate is a ratio of two estimates, its interval comes from the residuals misses - rate * accesses
+     * of the groups, relative to the estimated # of accesses*/
+    if (sum.dataAccesses > 0)
+    {
+        estimate->missRate = (double) (sum.readMisses + sum.writeMisses) / sum.dataAccesses;
+        for (g = 0; g < SAMPLE_GROUPS; g++)
+        {
+            const struct CacheStats* stats = &sample->stats[g];
+
+            if (sample->groupSets[g] > 0)
+            {
+                double residual = ((double) (stats->readMisses + stats->writeMisses) -
+                                   estimate->missRate * stats->dataAccesses) * cache->sets / sample->groupSets[g];
+
+                residualSum += residual;
+                residualSquares += residual * residual;
+                groups++;
+            }
+        }
+        estimate->missRateMargin =
+            sampleMargin(residualSum, residualSquares, groups, correction) / (sum.dataAccesses * scale);
+    }
+
+    for (f = 0; f < sizeof(statFields) / sizeof(statFields[0]); f++)
+    {
+        double groupSum = 0.0;
+        double groupSquares = 0.0;
+
+        groups = 0;
+        for (g = 0; g < SAMPLE_GROUPS; g++)
+        {
+            if (sample->groupSets[g] > 0)
+            {
+                double total = (double) STAT(&sample->stats[g], statFields[f]) * cache->sets / sample->groupSets[g];
+
+                groupSum += total;
+                groupSquares += total * total;
+                groups++;
+            }
+        }
+        STAT(&estimate->total, statFields[f]) = (unsigned long) llround(STAT(&sum, statFields[f]) * scale);
+        STAT(&estimate->margin, statFields[f]) =
+            (unsigned long) llround(sampleMargin(groupSum, groupSquares, groups, correction));
+    }
+}
+
+void sampleFree(struct CacheSample* sample)
+{
+    free(sample->groups);
+    sample->groups = NULL;
+}
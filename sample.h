@@ -0,0 +1,44 @@
+/*sample.h
+  Approximate simulation of a set-indexed cache by set sampling. A hash of the set index picks about rate of
+  the sets, and only the accesses that map to those sets are simulated. Sets never interact, so the sampled
+  sets behave exactly as they would in a full run, and scaling their counts by sets / sampled sets estimates
+  the totals of the whole cache.
+  The sampled sets are hashed into SAMPLE_GROUPS groups with their own statistics, and the spread of the
+  estimates of the groups gives a 95% confidence interval for each total (the random groups method).
+  */
+
+#ifndef SAMPLE_H
+#define SAMPLE_H
+
+#include <stdint.h>
+
+#include "cachesim.h"
+
+#define SAMPLE_GROUPS 16
+#define SAMPLE_NONE 0xFF /*Group of a set that is not sampled*/
+
+struct CacheSample
+{
+    double rate;
+    int sampledSets;
+    int groupSets[SAMPLE_GROUPS]; /*# of sampled sets in each group*/
+    uint8_t* groups; /*Group of every set, SAMPLE_NONE if it is not sampled*/
+    struct CacheStats stats[SAMPLE_GROUPS];
+};
+
+/*Totals of the whole cache estimated from a sample, each within margin of the exact total 95% of the time*/
+struct SampleEstimate
+{
+    struct CacheStats total;
+    struct CacheStats margin;
+    double missRate;
+    double missRateMargin;
+};
+
+int sampleInit(struct CacheSample* sample, const struct Cache* cache, double rate);
+void sampleRun(struct CacheSample* sample, struct Cache* cache, const struct TraceRecord* records, int n,
+               int64_t first);
+void sampleEstimate(const struct CacheSample* sample, const struct Cache* cache, struct SampleEstimate* estimate);
+void sampleFree(struct CacheSample* sample);
+
+#endif
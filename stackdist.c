@@ -0,0 +1,427 @@
+/*stackdist.c
+  LRU stack distance (Mattson) simulator: one pass over a trace gives the exact # of LRU misses
+  for every set-associativity at a fixed # of sets, i.e. for every cache size that shares the same index bits.
+  With 1 set the cache is fully associative and the output is the miss ratio curve over all capacities.
+  The stack distance of an access is the # of distinct blocks of the same set used since the last access
+  to its block, an access hits in every k-way cache with k > distance. Distances are counted with a
+  Fenwick tree over the access times of each set, so each access costs O(log n).
+  Dirty misses depend on the write history of each victim and are not reported, use system2.c for those.
+  How to execute:
+    1) gcc -O2 -o stackdist stackdist.c trace.c -lm -lz -lpthread
+    2) ./stackdist gcc.trace 128
+        (every k for 128 sets, i.e. k*2KB caches)
+    3) ./stackdist gcc.trace 1
+        (fully associative miss ratio curve)
+  */
+
+#include <inttypes.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "trace.h"
+
+#define BLOCK_SIZE 16
+#define BATCH 4096
+#define EMPTY_BLOCK UINT64_MAX
+#define FIRST_CAPACITY 64 /*Initial # of time slots of each set*/
+
+/*Access times of one set. Time t is marked in tree if blocks[t] was last used at time t,
+ * so the # of marks after time t is the # of distinct blocks used since then*/
+struct StackSet
+{
+    uint32_t now; /*Time of the last access to the set, times start at 1*/
+    uint32_t capacity;
+    uint32_t live; /*# of distinct blocks seen in the set, = # of marks*/
+    uint32_t* tree; /*Fenwick tree over times 1..capacity*/
+    uint64_t* blocks; /*Block last used at each time*/
+};
+
+/*Open addressing table from block address to its last access time*/
+struct LastUse
+{
+    uint64_t* blocks;
+    uint32_t* times;
+    size_t size; /*Power of 2*/
+    size_t used;
+};
+
+struct StackDist
+{
+    int sets;
+    int offset_size;
+    struct StackSet* stacks;
+    struct LastUse lastUse;
+
+    uint64_t* readHist; /*readHist[d] = # of reads with stack distance d*/
+    uint64_t* writeHist;
+    size_t histSize;
+    uint64_t coldReads; /*First use of a block, a miss for every cache size*/
+    uint64_t coldWrites;
+    uint64_t dataReads;
+    uint64_t dataWrites;
+    uint32_t maxDistance;
+};
+
+static void stackInit(struct StackDist*, int);
+static void stackAccess(struct StackDist*, char, uint64_t);
+static void stackPrint(const struct StackDist*);
+static void stackFree(struct StackDist*);
+
+int main(int argc, char* argv[])
+{
+    struct StackDist sd;
+    struct TraceReader trace;
+    struct TraceRecord* batch;
+    int sets;
+    int i;
+    int n;
+
+    /*Arguments: tracefile sets*/
+    if (argc != 3)
+    {
+        printf("Arguments required: tracefile sets\nExiting...\n");
+        exit(EXIT_FAILURE);
+    }
+
+    if (traceOpen(&trace, argv[1]) != 0)
+    {
+        perror("File could not be found in the current working directory\nExiting...\n");
+        exit(EXIT_FAILURE);
+    }
+
+    sets = strtol(argv[2], NULL, 10);
+    if (sets < 1 || (sets & (sets - 1)) != 0)
+    {
+        printf("sets must be a power of 2\nExiting...\n");
+        exit(EXIT_FAILURE);
+    }
+
+    stackInit(&sd, sets);
+    batch = malloc(BATCH * sizeof(*batch));
+    while ((n = traceRead(&trace, batch, BATCH)) > 0)
+    {
+        for (i = 0; i < n; i++)
+        {
+            stackAccess(&sd, traceOp(&batch[i]), batch[i].mem);
+        }
+    }
+    if (n < 0)
+    {
+        printf("Had trouble with reading line %" PRId64 " of trace\nExiting...\n", trace.line);
+        exit(EXIT_FAILURE);
+    }
+
+    stackPrint(&sd);
+
+    stackFree(&sd);
+    free(batch);
+    traceClose(&trace);
+    return 0;
+}
+
+static size_t hashBlock(uint64_t block)
+{
+    block ^= block >> 33;
+    block *= UINT64_C(0xff51afd7ed558ccd);
+    block ^= block >> 33;
+    return (size_t) block;
+}
+
+/*Slot of block in the table, or the empty slot it would go into*/
+static size_t lastUseSlot(const struct LastUse* lu, uint64_t block)
+{
+    size_t mask = lu->size - 1;
+    size_t slot = hashBlock(block) & mask;
+
+    while (lu->blocks[slot] != block && lu->blocks[slot] != EMPTY_BLOCK)
+    {
+        slot = (slot + 1) & mask;
+    }
+    return slot;
+}
+
+static void lastUseInit(struct LastUse* lu, size_t size)
+{
+    size_t i;
+
+    lu->size = size;
+    lu->used = 0;
+    lu->blocks = malloc(size * sizeof(*lu->blocks));
+    lu->times = malloc(size * sizeof(*lu->times));
+    if (lu->blocks == NULL || lu->times == NULL)
+    {
+        perror("Could not allocate the block table");
+        exit(EXIT_FAILURE);
+    }
+    for (i = 0; i < size; i++)
+    {
+        lu->blocks[i] = EMPTY_BLOCK;
+    }
+}
+
+static void lastUseGrow(struct LastUse* lu)
+{
+    struct LastUse old = *lu;
+    size_t i;
+
+    lastUseInit(lu, 2 * old.size);
+    for (i = 0; i < old.size; i++)
+    {
+        if (old.blocks[i] != EMPTY_BLOCK)
+        {
+            size_t slot = lastUseSlot(lu, old.blocks[i]);
+            lu->blocks[slot] = old.blocks[i];
+            lu->times[slot] = old.times[i];
+            lu->used++;
+        }
+    }
+    free(old.blocks);
+    free(old.times);
+}
+
+static void fenwickAdd(uint32_t* tree, uint32_t capacity, uint32_t t, int32_t value)
+{
+    for (; t <= capacity; t += t & -t)
+    {
+        tree[t] += (uint32_t) value;
+    }
+}
+
+/*# of marks at times 1..t*/
+static uint32_t fenwickSum(const uint32_t* tree, uint32_t t)
+{
+    uint32_t sum = 0;
+
+    for (; t > 0; t -= t & -t)
+    {
+        sum += tree[t];
+    }
+    return sum;
+}
+
+/*Renumber the marked times of a full set to 1..live, growing it if more than half of it is live.
+ * Keeps the time of every set bounded by twice its # of distinct blocks*/
+static void stackCompact(struct StackDist* sd, struct StackSet* set)
+{
+    uint32_t capacity = set->capacity;
+    uint32_t t;
+    uint32_t next = 0;
+
+    if (set->live > capacity / 2)
+    {
+        capacity *= 2;
+    }
+
+    for (t = 1; t <= set->now; t++)
+    {
+        uint64_t block = set->blocks[t];
+        size_t slot;
+
+        if (block == EMPTY_BLOCK)
+        {
+            continue;
+        }
+        slot = lastUseSlot(&sd->lastUse, block);
+        if (sd->lastUse.times[slot] == t)
+        {
+            next++;
+            set->blocks[next] = block;
+            sd->lastUse.times[slot] = next;
+        }
+    }
+
+    set->blocks = realloc(set->blocks, (capacity + 1) * sizeof(*set->blocks));
+    set->tree = realloc(set->tree, (capacity + 1) * sizeof(*set->tree));
+    if (set->blocks == NULL || set->tree == NULL)
+    {
+        perror("Could not grow the stack distance tree");
+        exit(EXIT_FAILURE);
+    }
+    for (t = next + 1; t <= capacity; t++)
+    {
+        set->blocks[t] = EMPTY_BLOCK;
+    }
+    /*Every time 1..next is marked, so each node covers exactly its own range*/
+    for (t = 1; t <= capacity; t++)
+    {
+        uint32_t low = t - (t & -t);
+        uint32_t high = t < next ? t : next;
+        set->tree[t] = high > low ? high - low : 0;
+    }
+    set->capacity = capacity;
+    set->now = next;
+}
+
+static void stackInit(struct StackDist* sd, int sets)
+{
+    int i;
+
+    memset(sd, 0, sizeof(*sd));
+    sd->sets = sets;
+    sd->offset_size = (int) log2((double) BLOCK_SIZE);
+    sd->stacks = calloc((size_t) sets, sizeof(*sd->stacks));
+    if (sd->stacks == NULL)
+    {
+        perror("Could not allocate the sets");
+        exit(EXIT_FAILURE);
+    }
+    for (i = 0; i < sets; i++)
+    {
+        uint32_t t;
+
+        sd->stacks[i].capacity = FIRST_CAPACITY;
+        sd->stacks[i].tree = calloc(FIRST_CAPACITY + 1, sizeof(uint32_t));
+        sd->stacks[i].blocks = malloc((FIRST_CAPACITY + 1) * sizeof(uint64_t));
+        if (sd->stacks[i].tree == NULL || sd->stacks[i].blocks == NULL)
+        {
+            perror("Could not allocate the sets");
+            exit(EXIT_FAILURE);
+        }
+        for (t = 0; t <= FIRST_CAPACITY; t++)
+        {
+            sd->stacks[i].blocks[t] = EMPTY_BLOCK;
+        }
+    }
+    lastUseInit(&sd->lastUse, 1024);
+    sd->histSize = 64;
+    sd->readHist = calloc(sd->histSize, sizeof(uint64_t));
+    sd->writeHist = calloc(sd->histSize, sizeof(uint64_t));
+}
+
+/*Simulate one load (Ld_St = 'L') or store (Ld_St = 'S') of address MEM in every cache size at once*/
+static void stackAccess(struct StackDist* sd, char Ld_St, uint64_t MEM)
+{
+    uint64_t block = MEM >> sd->offset_size;
+    struct StackSet* set = &sd->stacks[block & (uint64_t) (sd->sets - 1)];
+    size_t slot;
+    uint32_t t;
+
+    if (set->now == set->capacity)
+    {
+        stackCompact(sd, set);
+    }
+    t = ++set->now;
+    set->blocks[t] = block;
+
+    if (Ld_St == 'L')
+    {
+        sd->dataReads++;
+    }
+    else
+    {
+        sd->dataWrites++;
+    }
+
+    slot = lastUseSlot(&sd->lastUse, block);
+    if (sd->lastUse.blocks[slot] == EMPTY_BLOCK)
+    {
+        /*First use of the block*/
+        sd->lastUse.blocks[slot] = block;
+        sd->lastUse.times[slot] = t;
+        sd->lastUse.used++;
+        set->live++;
+        if (Ld_St == 'L')
+        {
+            sd->coldReads++;
+        }
+        else
+        {
+            sd->coldWrites++;
+        }
+        if (2 * sd->lastUse.used > sd->lastUse.size)
+        {
+            lastUseGrow(&sd->lastUse);
+        }
+    }
+    else
+    {
+        uint32_t last = sd->lastUse.times[slot];
+        uint32_t distance = fenwickSum(set->tree, t - 1) - fenwickSum(set->tree, last);
+
+        fenwickAdd(set->tree, set->capacity, last, -1);
+        set->blocks[last] = EMPTY_BLOCK;
+        sd->lastUse.times[slot] = t;
+
+        if (distance >= sd->histSize)
+        {
+            size_t size = sd->histSize;
+
+            while (size <= distance)
+            {
+                size *= 2;
+            }
+            sd->readHist = realloc(sd->readHist, size * sizeof(uint64_t));
+            sd->writeHist = realloc(sd->writeHist, size * sizeof(uint64_t));
+            memset(sd->readHist + sd->histSize, 0, (size - sd->histSize) * sizeof(uint64_t));
+            memset(sd->writeHist + sd->histSize, 0, (size - sd->histSize) * sizeof(uint64_t));
+            sd->histSize = size;
+        }
+        if (Ld_St == 'L')
+        {
+            sd->readHist[distance]++;
+        }
+        else
+        {
+            sd->writeHist[distance]++;
+        }
+        if (distance > sd->maxDistance)
+        {
+            sd->maxDistance = distance;
+        }
+    }
+    fenwickAdd(set->tree, set->capacity, t, 1);
+}
+
+/*Print the misses of every power of 2 set-associativity, up to the first one that only has cold misses*/
+static void stackPrint(const struct StackDist* sd)
+{
+    uint64_t readMisses = sd->dataReads;
+    uint64_t writeMisses = sd->dataWrites;
+    uint64_t dataAccesses = sd->dataReads + sd->dataWrites;
+    uint64_t k;
+    uint64_t d = 0;
+
+    printf("number of data reads = %" PRIu64 "\n", sd->dataReads);
+    printf("number of data writes = %" PRIu64 "\n", sd->dataWrites);
+    printf("number of data accesses = %" PRIu64 "\n", dataAccesses);
+    printf("number of distinct blocks = %zu\n", sd->lastUse.used);
+    printf("number of sets = %d%s\n\n", sd->sets, sd->sets == 1 ? " (fully associative)" : "");
+    printf("%-10s\t%-12s\t%-12s\t%-12s\t%-12s\t%-10s\n",
+           "k", "size (KB)", "read misses", "write misses", "data misses", "miss rate");
+
+    /*Misses of k ways = cold misses + accesses with a distance >= k*/
+    for (k = 1; ; k *= 2)
+    {
+        for (; d < k && d < sd->histSize; d++)
+        {
+            readMisses -= sd->readHist[d];
+            writeMisses -= sd->writeHist[d];
+        }
+        printf("%-10" PRIu64 "\t%-12g\t%-12" PRIu64 "\t%-12" PRIu64 "\t%-12" PRIu64 "\t%-10f\n",
+               k, (double) (k * (uint64_t) sd->sets * BLOCK_SIZE) / 1024, readMisses, writeMisses,
+               readMisses + writeMisses,
+               dataAccesses > 0 ? (double) (readMisses + writeMisses) / dataAccesses : 0.0);
+        if (k > sd->maxDistance)
+        {
+            break;
+        }
+    }
+}
+
+static void stackFree(struct StackDist* sd)
+{
+    int i;
+
+    for (i = 0; i < sd->sets; i++)
+    {
+        free(sd->stacks[i].tree);
+        free(sd->stacks[i].blocks);
+    }
+    free(sd->stacks);
+    free(sd->lastUse.blocks);
+    free(sd->lastUse.times);
+    free(sd->readHist);
+    free(sd->writeHist);
+}
@@ -0,0 +1,194 @@
+/*synth.c
+  Synthetic access patterns, see synth.h.
+  */
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "synth.h"
+
+const char* const synthNames[SYNTH_PATTERNS] = {"sequential", "strided", "random", "zipf", "chase"};
+
+/*splitmix64*/
+static uint64_t synthRandom(struct Synth* synth)
+{
+    uint64_t x = synth->state += 0x9E3779B97F4A7C15ULL;
+
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+}
+
+/*Uniform in [0, 1)*/
+static double synthUniform(struct Synth* synth)
+{
+    return (double) (synthRandom(synth) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+/*Returns -1 if name is not a pattern*/
+int synthPattern(const char* name, enum SynthPattern* pattern)
+{
+    int p;
+
+    for (p = 0; p < SYNTH_PATTERNS; p++)
+    {
+        if (strcmp(name, synthNames[p]) == 0)
+        {
+            *pattern = (enum SynthPattern) p;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+/*Returns -1 if the footprint is too small, or too large for the tables of zipf and chase*/
+int synthInit(struct Synth* synth, const struct SynthConfig* config)
+{
+    uint64_t w;
+
+    memset(synth, 0, sizeof(*synth));
+    synth->config = *config;
+    synth->words = config->footprint / 8;
+    synth->state = config->seed;
+    if (synth->words == 0 || (config->pattern == SYNTH_STRIDED && config->stride == 0))
+    {
+        return -1;
+    }
+
+    if (config->pattern == SYNTH_ZIPF)
+    {
+        double sum = 0.0;
+
+        synth->cdf = malloc(synth->words * sizeof(*synth->cdf));
+        if (synth->cdf == NULL)
+        {
+            return -1;
+        }
+        for (w = 0; w < synth->words; w++)
+        {
+            sum += 1.0 / pow((double) (w + 1), config->alpha);
+            synth->cdf[w] = sum;
+        }
+        for (w = 0; w < synth->words; w++)
+        {
+            synth->cdf[w] /= sum;
+        }
+    }
+    else if (config->pattern == SYNTH_CHASE)
+    {
+        uint32_t* order;
+
+        if (synth->words > UINT32_MAX)
+        {
+            return -1;
+        }
+        synth->next = malloc(synth->words * sizeof(*synth->next));
+        order = malloc(synth->words * sizeof(*order));
+        if (synth->next == NULL || order == NULL)
+        {
+            free(order);
+            return -1;
+        }
+        /*Sattolo's shuffle gives a permutation that is a single cycle through every word*/
+        for (w = 0; w < synth->words; w++)
+        {
+            order[w] = (uint32_t) w;
+        }
+        for (w = synth->words - 1; w > 0; w--)
+        {
+            uint64_t j = synthRandom(synth) % w;
+            uint32_t swap = order[w];
+
+            order[w] = order[j];
+            order[j] = swap;
+        }
+        for (w = 0; w < synth->words; w++)
+        {
+            synth->next[order[w]] = order[(w + 1) % synth->words];
+        }
+        free(order);
+    }
+
+    /*Sequential and strided patterns start at offset 0*/
+    if (config->pattern == SYNTH_SEQUENTIAL)
+    {
+        synth->position = config->footprint - 8;
+    }
+    else if (config->pattern == SYNTH_STRIDED)
+    {
+        synth->position = config->footprint - config->stride % config->footprint;
+    }
+    return 0;
+}
+
+/*Index of the first rank whose cumulative probability exceeds u*/
+static uint64_t synthZipfRank(const struct Synth* synth, double u)
+{
+    uint64_t low = 0;
+    uint64_t high = synth->words - 1;
+
+    while (low < high)
+    {
+        uint64_t middle = low + (high - low) / 2;
+
+        if (synth->cdf[middle] > u)
+        {
+            high = middle;
+        }
+        else
+        {
+            low = middle + 1;
+        }
+    }
+    return low;
+}
+
+/*Generate the next n accesses*/
+void synthFill(struct Synth* synth, struct TraceRecord* records, int n)
+{
+    const struct SynthConfig* config = &synth->config;
+    int j;
+
+    for (j = 0; j < n; j++)
+    {
+        uint64_t offset;
+        char op;
+
+        switch (config->pattern)
+        {
+        case SYNTH_SEQUENTIAL:
+            synth->position = (synth->position + 8) % config->footprint;
+            offset = synth->position;
+            break;
+        case SYNTH_STRIDED:
+            synth->position = (synth->position + config->stride) % config->footprint;
+            offset = synth->position;
+            break;
+        case SYNTH_RANDOM:
+            offset = synthRandom(synth) % synth->words * 8;
+            break;
+        case SYNTH_ZIPF:
+            /*Ranks are spread over the footprint by a multiplicative hash, so popular words are not neighbours*/
+            offset = synthZipfRank(synth, synthUniform(synth)) * UINT64_C(2654435761) % synth->words * 8;
+            break;
+        default:
+            synth->position = synth->next[synth->position];
+            offset = synth->position * 8;
+            break;
+        }
+        op = synthUniform(synth) < config->writes ? 'S' : 'L';
+        records[j].pc = (SYNTH_PC + 4 * (synth->count % SYNTH_PCS)) |
+                        ((uint64_t) (unsigned char) op << TRACE_OP_SHIFT);
+        records[j].mem = SYNTH_BASE + offset;
+        synth->count++;
+    }
+}
+
+void synthFree(struct Synth* synth)
+{
+    free(synth->cdf);
+    free(synth->next);
+    synth->cdf = NULL;
+    synth->next = NULL;
+}
@@ -0,0 +1,62 @@
+/*synth.h
+  Synthetic access patterns, for benchmarking the simulators without a lab trace. A generator fills arrays of
+  TraceRecords, so its output can be simulated directly (see bench.c) or written out as a trace (tracegen.c).
+  Every pattern touches a footprint of bytes starting at SYNTH_BASE, in 8 byte words:
+    sequential  word after word, wrapping around at the end of the footprint
+    strided     stride bytes at a time, wrapping around
+    random      uniformly random words
+    zipf        words drawn from a Zipf distribution of skew alpha, the popular ones scattered over the footprint
+    chase       a pointer chase through a single random cycle over all words, like a linked list walk
+  Each access is a store with probability writes. Generators are seeded, so a pattern is reproducible.
+  */
+
+#ifndef SYNTH_H
+#define SYNTH_H
+
+#include <stdint.h>
+
+#include "trace.h"
+
+#define SYNTH_BASE UINT64_C(0x10000000)
+#define SYNTH_PC UINT64_C(0x400000)
+#define SYNTH_PCS 16 /*# of distinct PCs of a pattern, as in a small loop body*/
+
+enum SynthPattern
+{
+    SYNTH_SEQUENTIAL,
+    SYNTH_STRIDED,
+    SYNTH_RANDOM,
+    SYNTH_ZIPF,
+    SYNTH_CHASE,
+    SYNTH_PATTERNS
+};
+
+struct SynthConfig
+{
+    enum SynthPattern pattern;
+    uint64_t footprint; /*Bytes, at least 8*/
+    uint64_t stride; /*Bytes, for SYNTH_STRIDED*/
+    double writes; /*Fraction of the accesses that are stores*/
+    double alpha; /*Skew of SYNTH_ZIPF*/
+    uint64_t seed;
+};
+
+struct Synth
+{
+    struct SynthConfig config;
+    uint64_t words; /*# of 8 byte words in the footprint*/
+    uint64_t state; /*splitmix64 state*/
+    uint64_t position; /*Byte offset of the last access, or word of the chase*/
+    uint64_t count; /*# of accesses generated*/
+    double* cdf; /*Cumulative probabilities of the ranks of SYNTH_ZIPF*/
+    uint32_t* next; /*Successor of every word in the cycle of SYNTH_CHASE*/
+};
+
+extern const char* const synthNames[SYNTH_PATTERNS];
+
+int synthPattern(const char* name, enum SynthPattern* pattern);
+int synthInit(struct Synth* synth, const struct SynthConfig* config);
+void synthFill(struct Synth* synth, struct TraceRecord* records, int n);
+void synthFree(struct Synth* synth);
+
+#endif
@@ -3,23 +3,47 @@
   How to execute on Unixlab:
     Copy system1.c to the relevant Unixlab folder with the scp command,
     log into Unixlab and run the following commands in Terminal:
-    1) gcc -o sys1 system1.c -lm
+    1) gcc -o sys1 system1.c cachesim.c checkpoint.c classify.c eventlog.c fullassoc.c monitor.c pcstats.c policy.c pool.c prefetch.c tagmatch.c trace.c traceindex.c -lm -lz -lpthread
     2) ./sys1 /unixlab/whsu/csc656/Traces/S18/P1/gcc.xac 2
         (with all the cache size variations and for each trace file)
+    3) ./sys1 /unixlab/whsu/csc656/Traces/S18/P1/gcc.xac 0.5,1,2,4
+        (sweep: every cache size is simulated in a single pass over the trace)
+    4) ./sys1 /unixlab/whsu/csc656/Traces/S18/P1/gcc.xac 0.5,1,2,4 -j 4
+        (the same sweep, with the cache sizes spread over 4 threads)
+    5) ./sys1 /unixlab/whsu/csc656/Traces/S18/P1/gcc.xac 64 -j 4
+        (a single cache, with its sets split over 4 threads)
+    6) ./sys1 /unixlab/whsu/csc656/Traces/S18/P1/gcc.xac 2 -v 5000000 5000100 -I gcc.idx -x
+        (the first run builds gcc.idx, later ones seek to the window through it and stop after it)
+    7) ./sys1 /unixlab/whsu/csc656/Traces/S18/P1/gcc.xac 2 -P 20
+        (also prints the 20 instructions whose misses cost the most cycles)
+    8) ./sys1 /unixlab/whsu/csc656/Traces/S18/P1/gcc.xac 2 -T gcc.csv -N 10000 -H gcc-sets.csv
+        (the statistics of every 10000 accesses, and the hits and misses of every set, as CSV)
+    9) ./sys1 /unixlab/whsu/csc656/Traces/S18/P1/gcc.xac 2 -C
+        (also splits the read and write misses into compulsory, capacity and conflict misses)
+    10) ./sys1 /unixlab/whsu/csc656/Traces/S18/P1/gcc.xac 2,4 -B 16,32,64,128,256
+        (every combination of cache size and block size, in a single pass)
+    11) ./sys1 /unixlab/whsu/csc656/Traces/S18/P1/gcc.xac 2 -F next
+        (prefetches the next block on every miss and on the first use of a prefetched block)
   */
 
 #include <errno.h>
 #include <inttypes.h>
-#include <math.h>
+#include <limits.h>
 #include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
-#define MISS_PENALTY 80
-#define BLOCK_SIZE 16
-
-char* caseNum = "NULL";
+#include "cachesim.h"
+#include "checkpoint.h"
+#include "classify.h"
+#include "eventlog.h"
+#include "monitor.h"
+#include "pcstats.h"
+#include "pool.h"
+#include "prefetch.h"
+#include "trace.h"
+#include "traceindex.h"
 
 /*Verbose mode header*/
 char* str1 = "order";
@@ -33,335 +57,669 @@ char* str8 = "hitMiss";
 char* str9 = "Case";
 
 
-double input_cachesize = 0.0;
-double missRate = 0.0;
-FILE *fp = NULL;
-int cacherows = 0;
-int cachesize = 0;
-int ctag = -1;
-int currentLine = 1;
-int dataAccesses = 0;
-int dataIndex = 0;
-int dataMisses = 0;
-int dataReads = 0;
-int dataWrites = 0;
-int dbit = -1;
-int dReadMisses = 0;
-int dWriteMisses = 0;
-int ic1 = 0;
-int ic2 = 0;
-int index_size = 0;
-int hitOrMiss = -1;
-int offset_size = 0; /* # of bits in block offset = log2(BLOCK_SIZE)*/
-int order = 0;
-int readBytes = 0;
-int readMisses = 0;
-int readCycles = 0;
-int tag_size = 0;
+int count = 0; /*used for verbose mode*/
+int64_t ic1 = 0;
+int64_t ic2 = 0;
 int verboseState = 0;
-int writeCycles = 0;
-int writeMisses = 0;
-unsigned long int readMEMBytes = 0;
-unsigned long int writtenMEMBytes = 0;
-uint64_t Index = 0;
-uint64_t offset = 0;
-uint64_t tag = 0;
-int8_t valid = 0;
-
-uint64_t ProgramCounter = 0;
-char Ld_St = '\0';
-uint64_t MEM = 0;
+struct EventLog* eventLog = NULL; /*-l: the accesses verbose mode covers are logged here instead of printed*/
+int pcTop = 0; /*-P: # of instructions to report the misses of, 0 for none*/
+struct Monitor* monitor = NULL; /*-T and -H: the time series and per-set counters of the cache*/
 
 void setVerbose(int);
 int verbose(const char *restrict, ...);
+void usage(void);
 
 
-struct DirectCache
+/*One simulated cache configuration, with its own statistics*/
+struct DirectSim
 {
-    unsigned int dbit : 1;
-    unsigned int valid : 1; /*valid only takes up 1 bit of space*/
-    uint64_t tag; /*Tag can at most be 63 bits, if the PC is 64 bits and the Index takes up 1 bit*/
+    struct Cache cache;
+    struct CacheStats stats;
+    struct PcTable* pcs; /*-P: the accesses and misses of every PC, NULL if they are not attributed*/
+    struct Classifier* classes; /*-C: the 3C classes of the misses, NULL if they are not classified*/
+    struct Prefetcher* prefetch; /*-F: the prefetcher of the cache, NULL to fetch on demand only*/
 };
 
+void directInit(struct DirectSim*, double, int);
+void directRun(void*, const struct TraceRecord*, int, int64_t);
+void directStep(void*, const struct TraceRecord*, int64_t);
+int64_t directRunPartitioned(struct DirectSim*, const struct PoolInput*, int);
+void directPrint(const struct DirectSim*);
+void directFree(struct DirectSim*);
+
 int main(int argc, char *argv[])
 {
     const char* filename;
 
-    /*Arguments: tracefile cachesize [-v ic1 ic2], where cachesize is a double*/
-    if (argc == 3 || argc == 6) /*There must be either 2 or 5 arguments*/
+    /*Arguments: tracefile cachesize[,cachesize...] [-v ic1 ic2] [-j threads] [-b records] [-l logfile]
+     * [-I indexfile] [-n interval] [-x] [-S checkpoint] [-R|-W checkpoint] [-P top] [-T seriesfile] [-N interval]
+     * [-H setsfile] [-C] [-B blocksize[,blocksize...]] [-F prefetcher[,degree]], where cachesize is a double, top
+     * the # of instructions to report, blocksize is in bytes and prefetcher one of next, stride or stream*/
+    if (argc >= 3)
     {
-        int count = 0; /*used for verbose mode*/
         int i;
-        struct DirectCache* dCache;
+        int64_t next; /*# of the first access not simulated*/
+        int n;
+        int nsims = 0;
+        int threads = 1;
+        int chunkSize = POOL_CHUNK;
+        const char* logName = NULL;
+        struct EventLog log;
+        const char* indexName = NULL;
+        int interval = INDEX_INTERVAL;
+        int stopAfterWindow = 0;
+        struct TraceIndex index;
+        int indexing = 0;
+        const char* saveName = NULL;
+        const char* loadName = NULL;
+        int resume = 0;
+        struct CheckpointStop stop;
+        struct PoolInput input;
+        char* list;
+        char* size;
+        char* sizePos;
+        const char* blockArg = NULL; /*-B: the block sizes to sweep, NULL for CACHE_BLOCK_SIZE*/
+        char* blockPos;
+        size_t combinations;
+        struct DirectSim* sims;
+        struct Pool* pool = NULL;
+        struct TraceReader trace;
+        void** simList;
+        const char* seriesName = NULL;
+        const char* setsName = NULL;
+        int seriesInterval = MONITOR_INTERVAL;
+        int classify = 0;
+        const char* prefetchArg = NULL;
+        struct Monitor monitorState;
+
+        for (i = 3; i < argc; i++)
+        {
+            if (strcmp(argv[i], "-v") == 0 && i + 2 < argc)
+            {
+                char* end1;
+                char* end2;
+                long long result1;
+                long long result2;
+
+                errno = 0;
+                result1 = strtoll(argv[i + 1], &end1, 10);
+                result2 = strtoll(argv[i + 2], &end2, 10);
+                if (errno == ERANGE || end1 == argv[i + 1] || *end1 != '\0' || end2 == argv[i + 2] || *end2 != '\0')
+                {
+                    printf("ic1 and ic2 must be base 10 integers of at most %" PRId64 "\nExiting...\n", INT64_MAX);
+                    exit(EXIT_FAILURE);
+                }
+                setVerbose(1);
+                ic1 = result1;
+                ic2 = result2;
+                i += 2;
+            }
+            else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc)
+            {
+                threads = strtol(argv[++i], NULL, 10);
+                if (threads < 1)
+                {
+                    printf("threads must be >= 1\nExiting...\n");
+                    exit(EXIT_FAILURE);
+                }
+            }
+            else if (strcmp(argv[i], "-l") == 0 && i + 1 < argc)
+            {
+                logName = argv[++i];
+            }
+            else if (strcmp(argv[i], "-I") == 0 && i + 1 < argc)
+            {
+                indexName = argv[++i];
+            }
+            else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc)
+            {
+                interval = strtol(argv[++i], NULL, 10);
+                if (interval < 1)
+                {
+                    printf("interval must be >= 1\nExiting...\n");
+                    exit(EXIT_FAILURE);
+                }
+            }
+            else if (strcmp(argv[i], "-S") == 0 && i + 1 < argc)
+            {
+                saveName = argv[++i];
+            }
+            else if ((strcmp(argv[i], "-R") == 0 || strcmp(argv[i], "-W") == 0) && i + 1 < argc)
+            {
+                resume = argv[i][1] == 'R';
+                loadName = argv[++i];
+            }
+            else if (strcmp(argv[i], "-x") == 0)
+            {
+                stopAfterWindow = 1;
+            }
+            else if (strcmp(argv[i], "-b") == 0 && i + 1 < argc)
+            {
+                chunkSize = strtol(argv[++i], NULL, 10);
+                if (chunkSize < 1)
+                {
+                    printf("records must be >= 1\nExiting...\n");
+                    exit(EXIT_FAILURE);
+                }
+            }
+            else if (strcmp(argv[i], "-P") == 0 && i + 1 < argc)
+            {
+                pcTop = strtol(argv[++i], NULL, 10);
+                if (pcTop < 1)
+                {
+                    printf("top must be >= 1\nExiting...\n");
+                    exit(EXIT_FAILURE);
+                }
+            }
+            else if (strcmp(argv[i], "-T") == 0 && i + 1 < argc)
+            {
+                seriesName = argv[++i];
+            }
+            else if (strcmp(argv[i], "-N") == 0 && i + 1 < argc)
+            {
+                seriesInterval = strtol(argv[++i], NULL, 10);
+                if (seriesInterval < 1)
+                {
+                    printf("interval must be >= 1\nExiting...\n");
+                    exit(EXIT_FAILURE);
+                }
+            }
+            else if (strcmp(argv[i], "-H") == 0 && i + 1 < argc)
+            {
+                setsName = argv[++i];
+            }
+            else if (strcmp(argv[i], "-C") == 0)
+            {
+                classify = 1;
+            }
+            else if (strcmp(argv[i], "-B") == 0 && i + 1 < argc)
+            {
+                blockArg = argv[++i];
+            }
+            else if (strcmp(argv[i], "-F") == 0 && i + 1 < argc)
+            {
+                prefetchArg = argv[++i];
+            }
+            else
+            {
+                usage();
+            }
+        }
+
+        /*-l without -v logs every access*/
+        if (logName != NULL && !verboseState)
+        {
+            setVerbose(1);
+            ic1 = 0;
+            ic2 = INT64_MAX;
+        }
 
         filename = argv[1]; /*filename = first argument*/
-        fp = fopen(filename, "r"); /*read-only mode*/
-        if (fp == NULL)
+        if (traceOpen(&trace, filename) != 0) /*read-only, memory-mapped if possible*/
         {
             perror("File could not be found in the current working directory\nExiting...\n");
             exit(EXIT_FAILURE);
         }
 
-        input_cachesize = atof(argv[2]);
-        if(ceil(1024*input_cachesize)==1024*input_cachesize && floor(1024*input_cachesize)==1024*input_cachesize)
+        /*Comma separated lists of cache sizes and block sizes sweep every combination of them in one pass
+         * over the trace*/
+        list = strdup(argv[2]);
+        combinations = (strlen(list) / 2 + 1) * (blockArg != NULL ? strlen(blockArg) / 2 + 1 : 1);
+        sims = calloc(combinations, sizeof(*sims));
+        simList = calloc(combinations, sizeof(*simList));
+        for (size = strtok_r(list, ",", &sizePos); size != NULL; size = strtok_r(NULL, ",", &sizePos))
         {
-            /*If the cachesize, represented in bytes, is an integer, then it can be converted to an int.*/
-            cachesize = (int)1024 * input_cachesize;
+            char* blocks = strdup(blockArg != NULL ? blockArg : "0");
+            char* block;
+
+            for (block = strtok_r(blocks, ",", &blockPos); block != NULL; block = strtok_r(NULL, ",", &blockPos))
+            {
+                char* end;
+                long blockSize = strtol(block, &end, 10);
+
+                if (end == block || *end != '\0' || blockSize < 0 || blockSize > INT_MAX)
+                {
+                    blockSize = -1; /*Rejected by cacheInit, as a size that is not a power of 2 is*/
+                }
+                directInit(&sims[nsims], atof(size), (int) blockSize);
+                simList[nsims] = &sims[nsims];
+                nsims++;
+            }
+            free(blocks);
         }
-        else
+        if (nsims == 0)
         {
             printf("cachesize*1024 must be an integer\n");
             exit(EXIT_FAILURE);
         }
-        /*Cache size minimum: 1 block of 16B*/
-        if (cachesize % 2 != 0 || cachesize < 16)
+        free(list);
+
+        for (i = 0; i < nsims && pcTop > 0; i++)
         {
-            printf("cachesize must be a power of 2 bytes. If it is,"
-                   "then the crash may have occurred because the cache size must be at least 2^-6 = 0.015625");
-            exit(EXIT_FAILURE);
+            sims[i].pcs = malloc(sizeof(*sims[i].pcs));
+            if (sims[i].pcs == NULL || pcTableInit(sims[i].pcs) != 0)
+            {
+                perror("Could not allocate the instruction table");
+                exit(EXIT_FAILURE);
+            }
         }
-
-        /*Since cachesize is the size of the data section in the cache, and because each row of the data section
-        is 16 Bytes, the # of rows in the cache = 1000*cachesize/16, where cachesize and 16 are both in KB.*/
-        cacherows = cachesize/16;
-        index_size = (int) log2((double)cacherows); /*cacherows is guaranteed to be a power of 2, so this is safe*/
-        offset_size = (int) log2((double) BLOCK_SIZE); /*This is safe because BLOCK_SIZE%2 = 0*/
-        tag_size = 64-index_size-offset_size;
-
-        if (argv[3] != NULL && strcmp(argv[3], "-v") == 0)
+        /*The shadow starts empty, so the cache must too*/
+        if (classify)
         {
-            setVerbose(1);
+            if (indexName != NULL || loadName != NULL)
+            {
+                printf("-C cannot be combined with -I, -R or -W\nExiting...\n");
+                exit(EXIT_FAILURE);
+            }
+            for (i = 0; i < nsims; i++)
+            {
+                sims[i].classes = malloc(sizeof(*sims[i].classes));
+                if (sims[i].classes == NULL || classifyInit(sims[i].classes, &sims[i].cache) != 0)
+                {
+                    perror("Could not allocate the shadow cache");
+                    exit(EXIT_FAILURE);
+                }
+            }
         }
+        /*The prefetcher starts with nothing in flight*/
+        if (prefetchArg != NULL)
+        {
+            enum PrefetchKind kind;
+            char name[16];
+            int degree = 0;
 
-        if(argc==6)
+            n = sscanf(prefetchArg, "%15[a-z],%d", name, &degree);
+            if (n < 1 || prefetchKind(name, &kind) != 0 || (n == 2 && (degree < 1 || degree > PREFETCH_DEGREE_MAX)))
+            {
+                printf("prefetcher must be next, stride or stream, optionally followed by ,degree with degree 1 to %d\n"
+                       "Exiting...\n", PREFETCH_DEGREE_MAX);
+                exit(EXIT_FAILURE);
+            }
+            if (indexName != NULL || loadName != NULL || classify)
+            {
+                printf("-F cannot be combined with -I, -R, -W or -C\nExiting...\n");
+                exit(EXIT_FAILURE);
+            }
+            for (i = 0; i < nsims; i++)
+            {
+                sims[i].prefetch = malloc(sizeof(*sims[i].prefetch));
+                if (sims[i].prefetch == NULL || prefetchInit(sims[i].prefetch, &sims[i].cache, kind, degree) != 0)
+                {
+                    perror("Could not allocate the prefetcher");
+                    exit(EXIT_FAILURE);
+                }
+            }
+        }
+        if (verboseState && nsims > 1)
         {
-            int result1 = strtol(argv[4], NULL, 10);
-            int result2 = strtol(argv[5], NULL, 10);
-            if(errno==22 || errno==34) /*If the base was unsupported or if overflow occurred*/
+            printf("Verbose mode requires a single cache size\nExiting...\n");
+            exit(EXIT_FAILURE);
+        }
+        if (logName != NULL)
+        {
+            eventLog = &log;
+            if (eventLogOpen(eventLog, logName, CACHE_DIRECT) != 0)
             {
-                perror("Could not convert 4th or 5th argument to a base 10 decimal");
+                perror("Could not create the event log");
                 exit(EXIT_FAILURE);
             }
-            ic1 = result1;
-            ic2 = result2;
         }
 
+        /*-x stops after the last access of the window. With -I, a run seeks to the last checkpoint before
+         * the window if the index exists, and builds it otherwise*/
+        memset(&input, 0, sizeof(input));
+        input.trace = &trace;
+        input.chunkSize = chunkSize;
+        input.last = stopAfterWindow && verboseState ? ic2 : -1;
+        if (indexName != NULL)
+        {
+            if (nsims > 1)
+            {
+                printf("An index requires a single cache size\nExiting...\n");
+                exit(EXIT_FAILURE);
+            }
+            n = indexOpen(&index, indexName, &trace, &sims[0].cache, &sims[0].stats);
+            if (n == -2)
+            {
+                printf("%s is not an index of this trace and cache\nExiting...\n", indexName);
+                exit(EXIT_FAILURE);
+            }
+            if (n == 0)
+            {
+                input.first = verboseState ? indexSeek(&index, &trace, ic1) : 0;
+            }
+            else
+            {
+                if (indexCreate(&index, indexName, &trace, &sims[0].cache, &sims[0].stats, interval) != 0)
+                {
+                    printf("Could not create %s, which requires a trace that is neither compressed nor piped\n"
+                           "Exiting...\n", indexName);
+                    exit(EXIT_FAILURE);
+                }
+                input.mark = indexMark;
+                input.markArg = &index;
+                indexing = 1;
+            }
+        }
 
-
-        dCache = calloc(cacherows, cacherows * sizeof(dCache));
-
-        /*Since each block in the data section is 16 Bytes = 32*4 bits = 64*2 bits (for the x86 architecture),
-         * each block will always contain two 64-bit addresses. Each data memory address is exactly 44 bits long
-         * , so there will be 20 wasted bits per address*/
-        for(i=0; i<cacherows; i++) /*initialize direct-mapped cache to 0*/
+        /*-R carries on from a checkpoint of this trace, -W only starts from its warm cache.
+         * -S saves one when the run ends or is interrupted*/
+        if ((saveName != NULL || loadName != NULL) && (nsims > 1 || indexName != NULL))
         {
-            dCache[i].valid = 0;
-            dCache[i].tag = 0;
-            dCache[i].dbit = 0;
+            printf("A checkpoint requires a single cache size, and no -I\nExiting...\n");
+            exit(EXIT_FAILURE);
         }
+        if (loadName != NULL)
+        {
+            struct CheckpointHeader header;
 
-        while(1)
+            n = checkpointLoad(loadName, &sims[0].cache, &sims[0].stats, &header);
+            if (n != 0)
+            {
+                printf(n == -2 ? "%s was saved from another cache\nExiting...\n" : "Could not read %s\nExiting...\n",
+                       loadName);
+                exit(EXIT_FAILURE);
+            }
+            if (!resume)
+            {
+                memset(&sims[0].stats, 0, sizeof(sims[0].stats));
+            }
+            else if (checkpointResume(&header, &trace) != 0)
+            {
+                printf("%s was not saved from this trace, which must be neither compressed nor piped\nExiting...\n",
+                       loadName);
+                exit(EXIT_FAILURE);
+            }
+            input.first = resume ? header.order : 0; /*The lines hold tags, so -W counts its trace from 0*/
+        }
+        if (saveName != NULL)
+        {
+            checkpointCatch(&stop, &input);
+        }
+        if (seriesName != NULL || setsName != NULL)
         {
-            int scanLine;
-
-            scanLine = fscanf(fp,
-                              "%*" SCNi32
-            "%" SCNx64
-            "%*" SCNi32
-            "%*" SCNi32
-            "%*" SCNi32
-            " %*c"
-            " %*c"
-            " %c"
-            "%*" SCNi64
-            "%" SCNx64
-            "%*" SCNx64
-            "%*" SCNx64
-            "%*11s"
-            "%*22s",
-                    &ProgramCounter,
-                    &Ld_St,
-                    &MEM);
-
-            if(scanLine==EOF)
-            {
-                break;
-            }
-
-            /*Only 3 fscanf units will be passed as arguments: ProgramCounter, Ld_St and MEM*/
-            if(scanLine != 3)
-            {
-                printf("Had trouble with reading line %i of trace\nExiting...\n", currentLine);
+            if (nsims > 1)
+            {
+                printf("-T and -H require a single cache size\nExiting...\n");
                 exit(EXIT_FAILURE);
             }
-
-
-            /*printf("ProgramCounter = %" PRIx64 "\t\tLd_St = %c\t\tMEM = %" PRIx64 "\n", ProgramCounter, Ld_St, MEM);*/
-            if(Ld_St=='L' || Ld_St=='S')
+            monitor = &monitorState;
+            if (monitorOpen(monitor, &sims[0].cache, seriesName, seriesInterval, setsName, input.first, 0,
+                            &sims[0].stats) != 0)
             {
-                offset = MEM << (index_size + tag_size);
-                offset = offset >> (index_size + tag_size);
-
-                Index = MEM >> offset_size; /*erase first offset_size bits of ProgramCounter*/
-                Index = Index << (offset_size + tag_size); /*erase upper tag_size bits of ProgramCounter*/
-                Index = Index >> (tag_size + offset_size); /*Move Index bits all the way to the right side*/
-
-                tag = MEM >> (index_size + offset_size);
-
-                dbit = dCache[Index].dbit;
-                ctag = dCache[Index].tag;
-                valid = dCache[Index].valid;
+                perror("Could not create the time series or set counters");
+                exit(EXIT_FAILURE);
+            }
+        }
 
-                if(Ld_St=='L')
+        /*With more than 1 thread, the caches of a sweep simulate each chunk of the trace in parallel,
+         * while a single cache is split by set over the threads, unless it is indexed between chunks or its
+         * accesses are counted one at a time*/
+        if (threads > 1 && nsims == 1 && !verboseState && !indexing && sims[0].pcs == NULL &&
+            sims[0].classes == NULL && sims[0].prefetch == NULL && monitor == NULL)
+        {
+            next = directRunPartitioned(&sims[0], &input, threads);
+        }
+        else
+        {
+            if (threads > 1)
+            {
+                pool = poolCreate(threads);
+                if (pool == NULL)
                 {
-                    /*Case 1: the block containing A is found in data cache (cache hit)*/
-                    /*Read: no state changes, 1 cycle*/
-                    if(dCache[Index].valid==1 && tag==dCache[Index].tag)
-                    {
-                        readCycles += 1;
-                        hitOrMiss = 1;
-                        caseNum = "1";
-                    }
-                    /*Case 2a: Clean cache miss, Read*/
-                    else if(dCache[Index].dbit==0 || dCache[Index].valid==0)
-                    {
-                        /*Read, move block containing A from MEM into Index I in data cache*/
-                        dCache[Index].tag = tag;
-                        dCache[Index].dbit = 0;
-                        dCache[Index].valid = 1;
-
-                        readMEMBytes += 16;
-                        readCycles += (1 + MISS_PENALTY);
-                        readMisses++;
-                        dataMisses++;
-                        dReadMisses++;
-                        hitOrMiss = 0;
-                        caseNum = "2a";
-                    }
-                    /*Case 2b: Dirty cache miss, Read*/
-                    else if(dCache[Index].valid==1 && tag != dCache[Index].tag && dCache[Index].dbit==1)
-                    {
-                        /*Read: write block X to memory, move block containing A from memory into data cache.*/
-                        dCache[Index].tag = tag;
-                        dCache[Index].dbit = 0;
-                        dCache[Index].valid = 1;
-
-                        writtenMEMBytes += 16;
-                        readMEMBytes += 16;
-                        readMisses++;
-                        dataMisses++;
-                        readCycles += (1 + 2*MISS_PENALTY);
-                        dReadMisses++;
-                        hitOrMiss = 0;
-                        caseNum = "2b";
-                    }
-
-                    dCache[Index].dbit = 0;
-                    dataReads++;
+                    perror("Could not start the worker threads");
+                    exit(EXIT_FAILURE);
                 }
-                else if(Ld_St=='S')
+            }
+            next = poolRunTrace(pool, &input, simList, nsims, directRun);
+        }
+        if (next < 0)
+        {
+            printf("Had trouble with reading line %" PRId64 " of trace\nExiting...\n", trace.line);
+            exit(EXIT_FAILURE);
+        }
+        if (pool != NULL)
+        {
+            poolDestroy(pool);
+        }
+        if (monitor != NULL && monitorClose(monitor, next - 1, &sims[0].stats) != 0)
+        {
+            perror("Could not write the time series or set counters");
+            exit(EXIT_FAILURE);
+        }
+        if (eventLog != NULL && eventLogClose(eventLog) != 0)
+        {
+            perror("Could not write the event log");
+            exit(EXIT_FAILURE);
+        }
+        if (indexName != NULL && indexClose(&index) != 0)
+        {
+            perror("Could not write the index");
+            exit(EXIT_FAILURE);
+        }
+        if (saveName != NULL)
+        {
+            if (stop.stopped)
+            {
+                printf("Interrupted before access %" PRId64 ", saving the cache to %s\n", stop.order, saveName);
+            }
+            if (checkpointSave(saveName, &sims[0].cache, &sims[0].stats, &trace, next,
+                               stop.stopped ? stop.offset : traceOffset(&trace), stop.stopped ? stop.line : trace.line)
+                != 0)
+            {
+                perror("Could not write the checkpoint");
+                exit(EXIT_FAILURE);
+            }
+        }
+
+        for (i = 0; i < nsims; i++)
+        {
+            if (nsims > 1)
+            {
+                if (blockArg != NULL)
                 {
-                    /*Case 1: Cache hit, Write*/
-                    if(dCache[Index].valid==1 && tag==dCache[Index].tag)
-                    {
-                        dCache[Index].tag = tag;
-                        dCache[Index].dbit = 1;
-                        dCache[Index].valid = 1;
-
-                        writtenMEMBytes += 16;
-                        writeCycles += 1;
-                        hitOrMiss = 1;
-                        caseNum = "1";
-                    }
-                    /*Case 2a: Clean cache miss, Write*/
-                    else if( (tag!=dCache[Index].tag && dCache[Index].dbit==0)
-                            || (dCache[Index].valid==0) )
-                    {
-                        /*Write: move block containing A from memory into Index I data cache, dirty bit = 1*/
-                        dCache[Index].tag = tag;
-                        dCache[Index].dbit = 1;
-                        dCache[Index].valid = 1;
-
-                        readMEMBytes += 16;
-                        writeCycles += (1 + MISS_PENALTY);
-                        writeMisses++;
-                        dataMisses++;
-                        dWriteMisses++;
-                        hitOrMiss = 0;
-                        caseNum = "2a";
-                    }
-                    /*Case 2b: Dirty cache miss, write*/
-                    else if(dCache[Index].dbit==1 && dCache[Index].valid==1 && tag!=dCache[Index].tag)
-                    {
-                        /*Write: write block X to memory move block containing A from memory into data cache*/
-                        dCache[Index].tag = tag;
-                        dCache[Index].dbit = 1;
-                        dCache[Index].valid = 1;
-
-                        readMEMBytes += 16;
-                        writtenMEMBytes += 16;
-                        writeCycles += (1 + 2*MISS_PENALTY);
-                        writeMisses++;
-                        dataMisses++;
-                        dWriteMisses++;
-                        hitOrMiss = 0;
-                        caseNum = "2b";
-                    }
-
-                    dataWrites++;
-                } /*End of Store*/
-
-                if(argc==6 && order>=ic1 && order<=ic2)
+                    printf("\ncache size = %gKB, block size = %dB\n", sims[i].cache.input_cachesize,
+                           sims[i].cache.blockSize);
+                }
+                else
                 {
-                    if(count==0)
-                    {
-                        printf("--The ideal window size for the Terminal to display the results is approximately "
-                               "half the screen--\n");
-                        verbose("%s\t%-10s\t%-12s\t%-12s\t%-10s\t%-12s\t%-10s\t%-10s\t%-10s\n",
-                                str1, str2, str3, str4, str5, str6, str7, str8, str9);
-                    }
-                    verbose("%d\t%-12" PRIx64 "\t%-12" PRIx64 "\t%-12" PRIx64 "\t%-10d\t%-12" PRIx64 "\t%-10d\t%-10d\t%-10s\n",
-                            order, MEM, Index, tag, valid, ctag, dbit, hitOrMiss,
-                            caseNum);
-                    count++;
+                    printf("\ncache size = %gKB\n", sims[i].cache.input_cachesize);
                 }
+            }
+            directPrint(&sims[i]);
+            directFree(&sims[i]);
+        }
+
+        free(sims);
+        free(simList);
+        traceClose(&trace);
+    }
+    else
+    {
+        usage();
+    }
+
 
 
-                order++;
-                dataAccesses++;
-            } /*End of load-store*/
 
-            currentLine++;
-        } /*end of while*/
+    return 0;
+}
 
-        printf("number of data reads = %d\n", dataReads);
-        printf("number of data writes = %d\n", dataWrites);
-        printf("number of data accesses = %d\n", dataAccesses);
-        printf("number of total data read misses = %d\n", readMisses);
-        printf("number of total data write misses = %d\n", writeMisses);
-        printf("number of data misses = %d\n", dataMisses);
-        printf("number of dirty data read misses = %d\n", dReadMisses);
-        printf("number of dirty write misses = %d\n", dWriteMisses);
-        printf("number of bytes read from memory = %lu\n", readMEMBytes);
-        printf("number of bytes written to memory = %lu\n", writtenMEMBytes);
-        printf("total access time (in cycles) for reads = %d\n", readCycles);
-        printf("total access time (in cycles) for writes = %d\n", writeCycles);
-        missRate = (double) (readMisses+writeMisses)/dataAccesses;
-        printf("overall data cache miss rate = %f\n", missRate);
+/*Simulate a chunk of the trace, the first record of which is access # first.
+ * Each chunk runs through one cache at a time, so only that cache competes with the chunk for the host's data cache*/
+void directRun(void* arg, const struct TraceRecord* records, int n, int64_t first)
+{
+    struct DirectSim* sim = arg;
+    int j;
 
+    for (j = 0; j < n; j++)
+    {
+        int64_t order = first + j;
+        unsigned long cycles = sim->stats.readCycles + sim->stats.writeCycles;
 
-        free(dCache);
+        if (sim->prefetch != NULL)
+        {
+            cycles = prefetchAccess(sim->prefetch, &sim->cache, &records[j], order, &sim->stats);
+        }
+        else
+        {
+            cacheAccess(&sim->cache, traceOp(&records[j]), records[j].mem, order, &sim->stats);
+            cycles = sim->stats.readCycles + sim->stats.writeCycles - cycles;
+        }
+        if (sim->pcs != NULL &&
+            pcCount(sim->pcs, records[j].pc & TRACE_PC_MASK, traceOp(&records[j]) == 'S', cycles) != 0)
+        {
+            perror("Could not grow the instruction table");
+            exit(EXIT_FAILURE);
+        }
+        if (sim->classes != NULL &&
+            classifyAccess(sim->classes, traceOp(&records[j]) == 'S', records[j].mem, cycles > 1) != 0)
+        {
+            perror("Could not grow the set of seen blocks");
+            exit(EXIT_FAILURE);
+        }
+        if (monitor != NULL)
+        {
+            monitorAccess(monitor, &sim->cache, order, cycles, &sim->stats);
+        }
+
+        if(verboseState && order>=ic1 && order<=ic2)
+        {
+            if (eventLog != NULL)
+            {
+                eventLogAccess(eventLog, &sim->cache, order, 0, records[j].mem);
+                continue;
+            }
+            if(count==0)
+            {
+                printf("--The ideal window size for the Terminal to display the results is approximately "
+                       "half the screen--\n");
+                verbose("%s\t%-10s\t%-12s\t%-12s\t%-10s\t%-12s\t%-10s\t%-10s\t%-10s\n",
+                        str1, str2, str3, str4, str5, str6, str7, str8, str9);
+            }
+            verbose("%" PRId64 "\t%-12" PRIx64 "\t%-12" PRIx64 "\t%-12" PRIx64 "\t%-10d\t%-12" PRIx64 "\t" \
+                    "%-10d\t%-10d\t%-10s\n",
+                    order, records[j].mem, sim->cache.last.Index, sim->cache.last.tag, sim->cache.last.valid,
+                    sim->cache.last.cTag, sim->cache.last.dbit, sim->cache.last.hitOrMiss,
+                    eventCases[sim->cache.last.caseNum]);
+            count++;
+        }
     }
-    else
+}
+
+/*Simulate one record of a set-partitioned run*/
+void directStep(void* arg, const struct TraceRecord* record, int64_t order)
+{
+    struct DirectSim* sim = arg;
+
+    cacheAccess(&sim->cache, traceOp(record), record->mem, order, &sim->stats);
+}
+
+/*Split sim by set over threads workers, each with its own statistics, see poolRunPartitioned.
+ * Each set still sees its accesses in trace order, so the totals match a serial run exactly*/
+int64_t directRunPartitioned(struct DirectSim* sim, const struct PoolInput* input, int threads)
+{
+    struct DirectSim* parts;
+    void** partList;
+    int64_t next;
+    int w;
+
+    if (threads > sim->cache.sets)
     {
-        printf("Arguments required: tracefile cachesize [-v ic1 ic2]\nExiting...\n");
+        threads = sim->cache.sets;
+    }
+    parts = calloc((size_t) threads, sizeof(*parts));
+    partList = calloc((size_t) threads, sizeof(*partList));
+    if (parts == NULL || partList == NULL)
+    {
+        perror("Could not allocate the set-partition workers");
         exit(EXIT_FAILURE);
     }
+    for (w = 0; w < threads; w++)
+    {
+        parts[w].cache = sim->cache; /*Shares the cache lines*/
+        partList[w] = &parts[w];
+    }
 
+    next = poolRunPartitioned(input, partList, threads, sim->cache.offset_size, sim->cache.index_size, directStep);
 
+    for (w = 0; w < threads; w++)
+    {
+        cacheStatsAdd(&sim->stats, &parts[w].stats);
+    }
+    free(parts);
+    free(partList);
+    return next;
+}
 
+/*Set up sim as an empty direct-mapped cache of input_cachesize KB with blocks of blockSize bytes
+ * (0 for CACHE_BLOCK_SIZE), exiting if that is not a valid cache*/
+void directInit(struct DirectSim* sim, double input_cachesize, int blockSize)
+{
+    struct CacheConfig config = {CACHE_DIRECT, input_cachesize, 1, NULL, blockSize};
+    const char* error;
+
+    memset(&sim->stats, 0, sizeof(sim->stats));
+    sim->pcs = NULL;
+    sim->classes = NULL;
+    sim->prefetch = NULL;
+    if (cacheInit(&sim->cache, &config, &error) != 0)
+    {
+        printf("%s\n", error);
+        exit(EXIT_FAILURE);
+    }
+}
 
-    return 0;
+void directPrint(const struct DirectSim* sim)
+{
+    double missRate;
+
+    printf("number of data reads = %lu\n", sim->stats.dataReads);
+    printf("number of data writes = %lu\n", sim->stats.dataWrites);
+    printf("number of data accesses = %lu\n", sim->stats.dataAccesses);
+    printf("number of total data read misses = %lu\n", sim->stats.readMisses);
+    printf("number of total data write misses = %lu\n", sim->stats.writeMisses);
+    printf("number of data misses = %lu\n", sim->stats.dataMisses);
+    printf("number of dirty data read misses = %lu\n", sim->stats.dReadMisses);
+    printf("number of dirty write misses = %lu\n", sim->stats.dWriteMisses);
+    printf("number of bytes read from memory = %lu\n", sim->stats.bytesRead);
+    printf("number of bytes written to memory = %lu\n", sim->stats.bytesWritten);
+    printf("total access time (in cycles) for reads = %lu\n", sim->stats.readCycles);
+    printf("total access time (in cycles) for writes = %lu\n", sim->stats.writeCycles);
+    missRate = (double) (sim->stats.readMisses+sim->stats.writeMisses)/sim->stats.dataAccesses;
+    printf("overall data cache miss rate = %f\n", missRate);
+    if (sim->prefetch != NULL)
+    {
+        prefetchPrint(sim->prefetch, &sim->stats);
+    }
+    if (sim->classes != NULL)
+    {
+        classifyPrint(sim->classes);
+    }
+    if (sim->pcs != NULL)
+    {
+        pcPrint(sim->pcs, pcTop);
+    }
+}
+
+void directFree(struct DirectSim* sim)
+{
+    if (sim->pcs != NULL)
+    {
+        pcTableFree(sim->pcs);
+        free(sim->pcs);
+    }
+    if (sim->classes != NULL)
+    {
+        classifyFree(sim->classes);
+        free(sim->classes);
+    }
+    if (sim->prefetch != NULL)
+    {
+        prefetchFree(sim->prefetch);
+        free(sim->prefetch);
+    }
+    cacheFree(&sim->cache);
 }
 
 void setVerbose(int state)
@@ -392,3 +750,13 @@ int verbose(const char *format, ...)
         return result;
     }
 }
+
+/*Print the arguments and exit*/
+void usage(void)
+{
+    printf("Arguments required: tracefile cachesize [-v ic1 ic2] [-j threads] [-b records] [-l logfile]"
+           " [-I indexfile] [-n interval] [-x] [-S checkpoint] [-R|-W checkpoint] [-P top]"
+           " [-T seriesfile] [-N interval] [-H setsfile] [-C] [-B blocksizes] [-F prefetcher]"
+           "\nExiting...\n");
+    exit(EXIT_FAILURE);
+}
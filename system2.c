@@ -3,22 +3,63 @@
   How to execute on Unixlab:
     Copy system2.c to the relevant Unixlab folder with the scp command,
     log into Unixlab and run the following commands in Terminal:
-    1) gcc -o sys2 system2.c -lm
-    2) ./sys2 /unixlab/whsu/csc656/Traces/S18/P1/gcc.xac 2
+    1) gcc -o sys2 system2.c cachesim.c checkpoint.c classify.c eventlog.c fullassoc.c hierarchy.c monitor.c pcstats.c policy.c pool.c prefetch.c sample.c tagmatch.c trace.c traceindex.c -lm -lz -lpthread
+    2) ./sys2 /unixlab/whsu/csc656/Traces/S18/P1/gcc.xac 2 4
         (with all the cache size variations and for each trace file)
+    3) ./sys2 /unixlab/whsu/csc656/Traces/S18/P1/gcc.xac 2,4 2,4,8
+        (sweep: every combination of cache size and set-associativity is simulated in a single pass)
+    4) ./sys2 /unixlab/whsu/csc656/Traces/S18/P1/gcc.xac 2,4 2,4,8 -j 4
+        (the same sweep, with the configurations spread over 4 threads)
+    5) ./sys2 /unixlab/whsu/csc656/Traces/S18/P1/gcc.xac 64 4 -j 4
+        (a single cache, with its sets split over 4 threads)
+    6) ./sys2 /unixlab/whsu/csc656/Traces/S18/P1/gcc.xac 16 16 -p srrip
+        (replacement policy: lru (the default), plru, srrip, brrip, fifo, random or legacy)
+    7) ./sys2 /unixlab/whsu/csc656/Traces/S18/P1/gcc.xac 64 full
+        (fully associative: k = the # of blocks in the cache)
+    8) ./sys2 /unixlab/whsu/csc656/Traces/S18/P1/gcc.xac 32 8 -L2 256,8 -L3 2048,16,40 -i inclusive
+        (an L1/L2/L3 hierarchy, L2 and L3 given as cachesize,k[,latency])
+    9) ./sys2 /unixlab/whsu/csc656/Traces/S18/P1/gcc.xac 2 4 -v 5000000 5000100 -I gcc.idx -x
+        (the first run builds gcc.idx, later ones seek to the window through it and stop after it)
+    10) ./sys2 /unixlab/whsu/csc656/Traces/S18/P1/gcc.xac 64,128,256 4,8,16 -s 0.05
+        (estimates from 5% of the sets of each cache, with 95% confidence intervals)
+    11) ./sys2 /unixlab/whsu/csc656/Traces/S18/P1/gcc.xac 64 4 -P 20
+        (also prints the 20 instructions whose misses cost the most cycles)
+    12) ./sys2 /unixlab/whsu/csc656/Traces/S18/P1/gcc.xac 64 4 -T gcc.csv -N 10000 -H gcc-sets.csv
+        (the statistics of every 10000 accesses, and the hits and misses of every set, as CSV)
+    13) ./sys2 /unixlab/whsu/csc656/Traces/S18/P1/gcc.xac 64 4 -C
+        (also splits the read and write misses into compulsory, capacity and conflict misses)
+    14) ./sys2 /unixlab/whsu/csc656/Traces/S18/P1/gcc.xac 64 4,8 -B 16,32,64,128,256
+        (every block size from 16 to 256 bytes with both set-associativities, in a single pass)
+    15) ./sys2 /unixlab/whsu/csc656/Traces/S18/P1/gcc.xac 64 4 -F stride,4
+        (prefetches 4 strides ahead of every load and store whose stride repeats)
   */
 
-#define MISS_PENALTY 80
-#define BLOCK_SIZE 16
+#define L1_LATENCY 1 /*Cycles for a lookup in each level of a hierarchy, unless given*/
+#define L2_LATENCY 10
+#define L3_LATENCY 30
 
 #include <errno.h>
 #include <inttypes.h>
-#include <math.h>
+#include <limits.h>
 #include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+#include "cachesim.h"
+#include "checkpoint.h"
+#include "classify.h"
+#include "eventlog.h"
+#include "hierarchy.h"
+#include "monitor.h"
+#include "pcstats.h"
+#include "policy.h"
+#include "pool.h"
+#include "prefetch.h"
+#include "sample.h"
+#include "trace.h"
+#include "traceindex.h"
+
 /*Verbose mode header*/
 char* str1 = "order";
 char* str2 = "MEM";
@@ -32,606 +73,881 @@ char* str9 = "dbit";
 char* str10 = "hitMiss";
 char* str11 = "Case";
 
-char* caseNum = "NULL";
-double input_cachesize = 0.0;
-double missRate = 0.0;
-int cachesize = 0;
-int caseCompleted = 0;
-int chosenBlock = 0;
-int dataAccesses = 0;
-int dataReads = 0;
-int dataWrites = 0;
-int dReadMisses = 0;
-int dWriteMisses = 0;
-int firstEmptyBlock = -1;
-int foundAddress = 0;
-int foundPair = 0;
-int ic1 = 0;
-int ic2 = 0;
-int hitOrMiss = 0;
-int k = 0;
-int index_size = 0;
-int lastUsed = 0;
-int minIndex = 0;
-int offset_size = 0;
-int order = 0;
-int readMisses = 0;
-int set_size = 0;
-int tag_size = 0;
-int totalMisses = 0;
-int valid = 0;
+int count = 0; /*used for verbose mode*/
+int64_t ic1 = 0;
+int64_t ic2 = 0;
+int64_t orderBase = 0; /*-W: # the cache gives access 0 of the trace, subtracted from every # reported*/
 int verboseState = 0;
-int writeMisses = 0;
-unsigned long int bytesRead = 0;
-unsigned long int bytesWritten = 0;
-unsigned long int dataMisses = 0;
-unsigned long int readCycles = 0;
-unsigned long int writeCycles = 0;
-
-uint64_t cTag = 0;
-uint64_t Index = 0;
-uint64_t offset = 0;
-uint64_t tag = 0;
-
-uint64_t ProgramCounter = 0;
-char Ld_St = '\0';
-uint64_t MEM = 0;
+struct EventLog* eventLog = NULL; /*-l: the accesses verbose mode covers are logged here instead of printed*/
+int pcTop = 0; /*-P: # of instructions to report the misses of, 0 for none*/
+struct Monitor* monitor = NULL; /*-T and -H: the time series and per-set counters of the cache*/
 
 void setVerbose(int);
 
 int verbose(const char* restrict, ...);
+void usage(void);
 
-struct KwayCache
+/*One simulated cache configuration, with its own statistics*/
+struct KwaySim
 {
-    unsigned int* valid; /*valid only takes up 1 bit of space*/
-    unsigned int* dbit;
-    uint64_t* tag; /*Tag can at most be 63 bits, if the PC is 64 bits and the Index takes up 1 bit*/
-    unsigned int* LU; /*Indicates when the given cache block was last used*/
+    struct Cache cache;
+    struct CacheStats stats;
+    struct CacheSample* sample; /*-s: the sets simulated, NULL to simulate them all*/
+    struct PcTable* pcs; /*-P: the accesses and misses of every PC, NULL if they are not attributed*/
+    struct Classifier* classes; /*-C: the 3C classes of the misses, NULL if they are not classified*/
+    struct Prefetcher* prefetch; /*-F: the prefetcher of the cache, NULL to fetch on demand only*/
 };
 
+void kwayInit(struct KwaySim*, double, int, const struct Policy*, double, int);
+void kwayRun(void*, const struct TraceRecord*, int, int64_t);
+void kwayStep(void*, const struct TraceRecord*, int64_t);
+int64_t kwayRunPartitioned(struct KwaySim*, const struct PoolInput*, int);
+void kwayPrint(const struct KwaySim*);
+void kwayPrintSample(const struct KwaySim*);
+void kwayFree(struct KwaySim*);
+void kwayHierarchy(struct Hierarchy*, const struct KwaySim*, const char**, enum Inclusion, const struct Policy*);
+
 
 int main(int argc, const char* argv[])
 {
     const char* filename;
-    FILE* fp = NULL;
-    int currentLine = 1;
-
-    /*Arguments: tracefile cachesize set-associativity [-v ic1 ic2], where cachesize is a double*/
-    if (argc == 4 || argc == 7) /*There must be either 2 or 5 arguments*/
+    struct TraceReader trace;
+
+    /*Arguments: tracefile cachesize[,cachesize...] set-associativity[,k...] [-v ic1 ic2] [-j threads] [-b records]
+     * [-l logfile] [-I indexfile] [-n interval] [-x] [-S checkpoint] [-R|-W checkpoint] [-p policy]
+     * [-L2 cachesize,k[,latency]] [-L3 cachesize,k[,latency]] [-i inclusion] [-s rate] [-P top] [-T seriesfile]
+     * [-N interval] [-H setsfile] [-C] [-B blocksize[,blocksize...]] [-F prefetcher[,degree]], where cachesize is
+     * a double, rate the fraction of the sets to sample, top the # of instructions to report, blocksize is in bytes
+     * and prefetcher one of next, stride or stream*/
+    if (argc >= 4)
     {
-        int count = 0; /*used for verbose mode*/
-        int dbit = 0;
         int i;
-        int selectedBlock = -1; /*The block # of the given block, selected within the given set of the cache*/
-        struct KwayCache* kCache;
+        int64_t next; /*# of the first access not simulated*/
+        int n;
+        int nsims = 0;
+        int threads = 1;
+        int chunkSize = POOL_CHUNK;
+        const char* logName = NULL;
+        struct EventLog log;
+        const char* indexName = NULL;
+        int interval = INDEX_INTERVAL;
+        int stopAfterWindow = 0;
+        struct TraceIndex index;
+        int indexing = 0;
+        const char* saveName = NULL;
+        const char* loadName = NULL;
+        int resume = 0;
+        struct CheckpointStop stop;
+        struct PoolInput input;
+        char* sizes;
+        const char* blockArg = NULL; /*-B: the block sizes to sweep, NULL for CACHE_BLOCK_SIZE*/
+        char* blockPos;
+        size_t combinations;
+        char* size;
+        char* kArg;
+        char* sizePos;
+        char* kPos;
+        struct KwaySim* sims;
+        struct Pool* pool = NULL;
+        const struct Policy* policy = policyFind("lru");
+        void** simList;
+        const char* levelArgs[HIER_LEVELS] = {NULL, NULL, NULL}; /*-L2 and -L3*/
+        enum Inclusion inclusion = NINE;
+        struct Hierarchy* hiers = NULL;
+        double sampleRate = 1.0;
+        const char* seriesName = NULL;
+        const char* setsName = NULL;
+        int seriesInterval = MONITOR_INTERVAL;
+        int classify = 0;
+        const char* prefetchArg = NULL;
+        struct Monitor monitorState;
+
+        for (i = 4; i < argc; i++)
+        {
+            if (strcmp(argv[i], "-v") == 0 && i + 2 < argc)
+            {
+                char* end1;
+                char* end2;
+                long long result1;
+                long long result2;
+
+                errno = 0;
+                result1 = strtoll(argv[i + 1], &end1, 10);
+                result2 = strtoll(argv[i + 2], &end2, 10);
+                if (errno == ERANGE || end1 == argv[i + 1] || *end1 != '\0' || end2 == argv[i + 2] || *end2 != '\0')
+                {
+                    printf("ic1 and ic2 must be base 10 integers of at most %" PRId64 "\nExiting...\n", INT64_MAX);
+                    exit(EXIT_FAILURE);
+                }
+                setVerbose(1);
+                ic1 = result1;
+                ic2 = result2;
+                i += 2;
+            }
+            else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc)
+            {
+                threads = strtol(argv[++i], NULL, 10);
+                if (threads < 1)
+                {
+                    printf("threads must be >= 1\nExiting...\n");
+                    exit(EXIT_FAILURE);
+                }
+            }
+            else if (strcmp(argv[i], "-l") == 0 && i + 1 < argc)
+            {
+                logName = argv[++i];
+            }
+            else if (strcmp(argv[i], "-I") == 0 && i + 1 < argc)
+            {
+                indexName = argv[++i];
+            }
+            else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc)
+            {
+                interval = strtol(argv[++i], NULL, 10);
+                if (interval < 1)
+                {
+                    printf("interval must be >= 1\nExiting...\n");
+                    exit(EXIT_FAILURE);
+                }
+            }
+            else if (strcmp(argv[i], "-S") == 0 && i + 1 < argc)
+            {
+                saveName = argv[++i];
+            }
+            else if ((strcmp(argv[i], "-R") == 0 || strcmp(argv[i], "-W") == 0) && i + 1 < argc)
+            {
+                resume = argv[i][1] == 'R';
+                loadName = argv[++i];
+            }
+            else if (strcmp(argv[i], "-x") == 0)
+            {
+                stopAfterWindow = 1;
+            }
+            else if (strcmp(argv[i], "-b") == 0 && i + 1 < argc)
+            {
+                chunkSize = strtol(argv[++i], NULL, 10);
+                if (chunkSize < 1)
+                {
+                    printf("records must be >= 1\nExiting...\n");
+                    exit(EXIT_FAILURE);
+                }
+            }
+            else if (strcmp(argv[i], "-p") == 0 && i + 1 < argc)
+            {
+                i++;
+                if (strcmp(argv[i], "legacy") == 0)
+                {
+                    policy = NULL;
+                }
+                else if ((policy = policyFind(argv[i])) == NULL)
+                {
+                    printf("policy must be one of %s, legacy\nExiting...\n", policyNames());
+                    exit(EXIT_FAILURE);
+                }
+            }
+            else if ((strcmp(argv[i], "-L2") == 0 || strcmp(argv[i], "-L3") == 0) && i + 1 < argc)
+            {
+                levelArgs[argv[i][2] - '1'] = argv[i + 1];
+                i++;
+            }
+            else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc)
+            {
+                sampleRate = atof(argv[++i]);
+                if (sampleRate <= 0.0 || sampleRate > 1.0)
+                {
+                    printf("rate must be > 0 and <= 1\nExiting...\n");
+                    exit(EXIT_FAILURE);
+                }
+            }
+            else if (strcmp(argv[i], "-P") == 0 && i + 1 < argc)
+            {
+                pcTop = strtol(argv[++i], NULL, 10);
+                if (pcTop < 1)
+                {
+                    printf("top must be >= 1\nExiting...\n");
+                    exit(EXIT_FAILURE);
+                }
+            }
+            else if (strcmp(argv[i], "-T") == 0 && i + 1 < argc)
+            {
+                seriesName = argv[++i];
+            }
+            else if (strcmp(argv[i], "-N") == 0 && i + 1 < argc)
+            {
+                seriesInterval = strtol(argv[++i], NULL, 10);
+                if (seriesInterval < 1)
+                {
+                    printf("interval must be >= 1\nExiting...\n");
+                    exit(EXIT_FAILURE);
+                }
+            }
+            else if (strcmp(argv[i], "-H") == 0 && i + 1 < argc)
+            {
+                setsName = argv[++i];
+            }
+            else if (strcmp(argv[i], "-C") == 0)
+            {
+                classify = 1;
+            }
+            else if (strcmp(argv[i], "-B") == 0 && i + 1 < argc)
+            {
+                blockArg = argv[++i];
+            }
+            else if (strcmp(argv[i], "-F") == 0 && i + 1 < argc)
+            {
+                prefetchArg = argv[++i];
+            }
+            else if (strcmp(argv[i], "-i") == 0 && i + 1 < argc)
+            {
+                if (hierInclusion(argv[++i], &inclusion) != 0)
+                {
+                    printf("inclusion must be one of inclusive, exclusive, nine\nExiting...\n");
+                    exit(EXIT_FAILURE);
+                }
+            }
+            else
+            {
+                usage();
+            }
+        }
+
+        /*-l without -v logs every access*/
+        if (logName != NULL && !verboseState)
+        {
+            setVerbose(1);
+            ic1 = 0;
+            ic2 = INT64_MAX;
+        }
 
         filename = argv[1]; /*filename = first argument*/
-        fp = fopen(filename, "r"); /*read-only mode*/
-        if (fp == NULL)
+        if (traceOpen(&trace, filename) != 0) /*read-only, memory-mapped if possible*/
         {
             perror("File could not be found in the current working directory\nExiting...\n");
             exit(EXIT_FAILURE);
         }
 
+        /*Comma separated lists of cache sizes, set-associativities and block sizes sweep every combination
+         * of them in one pass over the trace*/
+        sizes = strdup(argv[2]);
+        combinations = (strlen(argv[2]) / 2 + 1) * (strlen(argv[3]) / 2 + 1) *
+                       (blockArg != NULL ? strlen(blockArg) / 2 + 1 : 1);
+        sims = calloc(combinations, sizeof(*sims));
+        simList = calloc(combinations, sizeof(*simList));
+        for (size = strtok_r(sizes, ",", &sizePos); size != NULL; size = strtok_r(NULL, ",", &sizePos))
+        {
+            char* list = strdup(argv[3]);
+
+            for (kArg = strtok_r(list, ",", &kPos); kArg != NULL; kArg = strtok_r(NULL, ",", &kPos))
+            {
+                char* blocks = strdup(blockArg != NULL ? blockArg : "0");
+                char* block;
+
+                for (block = strtok_r(blocks, ",", &blockPos); block != NULL; block = strtok_r(NULL, ",", &blockPos))
+                {
+                    char* end;
+                    long blockSize = strtol(block, &end, 10);
 
-        input_cachesize = atof(argv[2]);
-        if (ceil(1024 * input_cachesize) == 1024 * input_cachesize &&
-            floor(1024 * input_cachesize) == 1024 * input_cachesize)
+                    if (end == block || *end != '\0' || blockSize < 0 || blockSize > INT_MAX)
+                    {
+                        blockSize = -1; /*Rejected by cacheInit, as a size that is not a power of 2 is*/
+                    }
+                    kwayInit(&sims[nsims], atof(size),
+                             strcmp(kArg, "full") == 0 ? FULLY_ASSOCIATIVE : strtol(kArg, NULL, 10), policy,
+                             sampleRate, (int) blockSize);
+                    simList[nsims] = &sims[nsims];
+                    nsims++;
+                }
+                free(blocks);
+            }
+            free(list);
+        }
+        free(sizes);
+        if (nsims == 0)
         {
-            cachesize = (int) 1024 * input_cachesize;
+            usage();
         }
-        else
+
+        if (sampleRate < 1.0 && (verboseState || levelArgs[1] != NULL || indexName != NULL || saveName != NULL ||
+                                 loadName != NULL))
         {
-            printf("cachesize*1024 must be an integer\n");
+            printf("Sampling cannot be combined with -v, -l, -I, -S, -R, -W or -L2\nExiting...\n");
             exit(EXIT_FAILURE);
         }
+        if (pcTop > 0)
+        {
+            if (sampleRate < 1.0 || levelArgs[1] != NULL)
+            {
+                printf("-P cannot be combined with -s or -L2\nExiting...\n");
+                exit(EXIT_FAILURE);
+            }
+            for (i = 0; i < nsims; i++)
+            {
+                sims[i].pcs = malloc(sizeof(*sims[i].pcs));
+                if (sims[i].pcs == NULL || pcTableInit(sims[i].pcs) != 0)
+                {
+                    perror("Could not allocate the instruction table");
+                    exit(EXIT_FAILURE);
+                }
+            }
+        }
+        /*The shadow starts empty, so the cache must too*/
+        if (classify)
+        {
+            if (sampleRate < 1.0 || levelArgs[1] != NULL || indexName != NULL || loadName != NULL)
+            {
+                printf("-C cannot be combined with -s, -L2, -I, -R or -W\nExiting...\n");
+                exit(EXIT_FAILURE);
+            }
+            for (i = 0; i < nsims; i++)
+            {
+                sims[i].classes = malloc(sizeof(*sims[i].classes));
+                if (sims[i].classes == NULL || classifyInit(sims[i].classes, &sims[i].cache) != 0)
+                {
+                    perror("Could not allocate the shadow cache");
+                    exit(EXIT_FAILURE);
+                }
+            }
+        }
+        /*The prefetcher starts with nothing in flight, and fills the cache through its replacement policy*/
+        if (prefetchArg != NULL)
+        {
+            enum PrefetchKind kind;
+            char name[16];
+            int degree = 0;
 
-
-        k = strtol(argv[3], NULL, 10);
-        if (k == 0)
+            n = sscanf(prefetchArg, "%15[a-z],%d", name, &degree);
+            if (n < 1 || prefetchKind(name, &kind) != 0 || (n == 2 && (degree < 1 || degree > PREFETCH_DEGREE_MAX)))
+            {
+                printf("prefetcher must be next, stride or stream, optionally followed by ,degree with degree 1 to %d\n"
+                       "Exiting...\n", PREFETCH_DEGREE_MAX);
+                exit(EXIT_FAILURE);
+            }
+            if (sampleRate < 1.0 || levelArgs[1] != NULL || indexName != NULL || loadName != NULL || classify ||
+                policy == NULL)
+            {
+                printf("-F cannot be combined with -s, -L2, -I, -R, -W, -C or -p legacy\nExiting...\n");
+                exit(EXIT_FAILURE);
+            }
+            for (i = 0; i < nsims; i++)
+            {
+                sims[i].prefetch = malloc(sizeof(*sims[i].prefetch));
+                if (sims[i].prefetch == NULL || prefetchInit(sims[i].prefetch, &sims[i].cache, kind, degree) != 0)
+                {
+                    perror("Could not allocate the prefetcher");
+                    exit(EXIT_FAILURE);
+                }
+            }
+        }
+        if (verboseState && nsims > 1)
         {
-            perror("A problem occurred when reading the 2nd argument (set-associativity)");
+            printf("Verbose mode requires a single cache size and set-associativity\nExiting...\n");
             exit(EXIT_FAILURE);
         }
-        else if(k<2)
+        if (logName != NULL)
         {
-            printf("k must be >= 2\n");
-            exit(EXIT_FAILURE);
+            eventLog = &log;
+            if (eventLogOpen(eventLog, logName, CACHE_KWAY) != 0)
+            {
+                perror("Could not create the event log");
+                exit(EXIT_FAILURE);
+            }
         }
 
-        /*Cache size minimum: k blocks of 16B*/
-        if (cachesize % 2 != 0 || cachesize < (k * 16))
+        /*With -L2, every configuration is the L1 of its own hierarchy*/
+        if (levelArgs[2] != NULL && levelArgs[1] == NULL)
         {
-            printf("cachesize must be a power of 2 bytes. If it is,"
-                   "then the crash may have occurred because the cache size must be at least 2^-6 = 0.015625");
+            printf("-L3 requires -L2\nExiting...\n");
             exit(EXIT_FAILURE);
         }
-
-        if (argv[4] != NULL && strcmp(argv[4], "-v") == 0)
+        if (levelArgs[1] != NULL)
         {
-            setVerbose(1);
+            if (verboseState)
+            {
+                printf("Verbose mode does not support a cache hierarchy\nExiting...\n");
+                exit(EXIT_FAILURE);
+            }
+            if (policy == NULL) /*The legacy victim search only exists for a single cache*/
+            {
+                printf("-L2 cannot be combined with -p legacy\nExiting...\n");
+                exit(EXIT_FAILURE);
+            }
+            hiers = calloc((size_t) nsims, sizeof(*hiers));
+            for (i = 0; i < nsims; i++)
+            {
+                kwayHierarchy(&hiers[i], &sims[i], levelArgs, inclusion, policy);
+                simList[i] = &hiers[i];
+            }
         }
 
-        if (argc == 7)
+        /*-x stops after the last access of the window. With -I, a run seeks to the last checkpoint before
+         * the window if the index exists, and builds it otherwise*/
+        memset(&input, 0, sizeof(input));
+        input.trace = &trace;
+        input.chunkSize = chunkSize;
+        input.last = stopAfterWindow && verboseState ? ic2 : -1;
+        if (indexName != NULL)
         {
-            int result1 = strtol(argv[5], NULL, 10);
-            int result2 = strtol(argv[6], NULL, 10);
-            if (errno == 22 || errno == 34) /*If the base was unsupported or if overflow occurred*/
+            if (nsims > 1 || hiers != NULL)
+            {
+                printf("An index requires a single cache size and set-associativity\nExiting...\n");
+                exit(EXIT_FAILURE);
+            }
+            n = indexOpen(&index, indexName, &trace, &sims[0].cache, &sims[0].stats);
+            if (n == -2)
             {
-                perror("Could not convert 5th or 6th argument to a base 10 decimal");
+                printf("%s is not an index of this trace and cache\nExiting...\n", indexName);
                 exit(EXIT_FAILURE);
             }
-            ic1 = result1;
-            ic2 = result2;
+            if (n == 0)
+            {
+                input.first = verboseState ? indexSeek(&index, &trace, ic1) : 0;
+            }
+            else
+            {
+                if (indexCreate(&index, indexName, &trace, &sims[0].cache, &sims[0].stats, interval) != 0)
+                {
+                    printf("Could not create %s, which requires a trace that is neither compressed nor piped\n"
+                           "Exiting...\n", indexName);
+                    exit(EXIT_FAILURE);
+                }
+                input.mark = indexMark;
+                input.markArg = &index;
+                indexing = 1;
+            }
         }
 
-
-        set_size = cachesize / (k * 16);
-        kCache = calloc(set_size, set_size * sizeof(kCache));
-        /*For every set in the cache, allocate k blocks per set*/
-        for (i = 0; i < set_size; i++)
+        /*-R carries on from a checkpoint of this trace, -W only starts from its warm cache.
+         * -S saves one when the run ends or is interrupted*/
+        if ((saveName != NULL || loadName != NULL) && (nsims > 1 || hiers != NULL || indexName != NULL))
         {
-            kCache[i].valid = calloc(k, k * sizeof(kCache[i].valid));
-            kCache[i].dbit = calloc(k, k * sizeof(kCache[i].dbit));
-            kCache[i].tag = calloc(k, k * sizeof(kCache[i].tag));
-            kCache[i].LU = calloc(k, k * sizeof(kCache[i].LU));
+            printf("A checkpoint requires a single cache size and set-associativity, and no -I\nExiting...\n");
+            exit(EXIT_FAILURE);
         }
-
-
-        offset_size = (int) log2((double) BLOCK_SIZE); /*This is safe because BLOCK_SIZE%2 = 0*/
-        index_size = (int) log2((double) set_size); /*set_size is guaranteed to be a power of 2, so this is safe*/
-        tag_size = 64 - index_size - offset_size;
-
-        while (1)
+        if (loadName != NULL)
         {
-            int scanLine;
-
-            scanLine = fscanf(fp,
-                              "%*" SCNi32
-                              "%" SCNx64
-                              "%*" SCNi32
-                              "%*" SCNi32
-                              "%*" SCNi32
-                              " %*c"
-                              " %*c"
-                              " %c"
-                              "%*" SCNi64
-                              "%" SCNx64
-                              "%*" SCNx64
-                              "%*" SCNx64
-                              "%*11s"
-                              "%*22s",
-                              &ProgramCounter,
-                              &Ld_St,
-                              &MEM);
+            struct CheckpointHeader header;
 
-            if (scanLine == EOF)
+            n = checkpointLoad(loadName, &sims[0].cache, &sims[0].stats, &header);
+            if (n != 0)
             {
-                break;
+                printf(n == -2 ? "%s was saved from another cache\nExiting...\n" : "Could not read %s\nExiting...\n",
+                       loadName);
+                exit(EXIT_FAILURE);
             }
-
-            /*Only 3 fscanf units will be passed as arguments: ProgramCounter, Ld_St and MEM*/
-            if (scanLine != 3)
+            if (!resume)
             {
-                printf("Had trouble with reading line %i of trace\nExiting...\n", currentLine);
+                memset(&sims[0].stats, 0, sizeof(sims[0].stats));
+            }
+            else if (checkpointResume(&header, &trace) != 0)
+            {
+                printf("%s was not saved from this trace, which must be neither compressed nor piped\nExiting...\n",
+                       loadName);
                 exit(EXIT_FAILURE);
             }
-
-            if (Ld_St == 'L' || Ld_St == 'S')
+            /*The lines hold the # of the access that last used them, so the cache carries on counting from there.
+             * -W still reports the accesses of its trace from 0*/
+            input.first = header.order;
+            if (!resume)
             {
+                orderBase = header.order;
+                input.last += input.last >= 0 ? orderBase : 0;
+            }
+        }
+        if (saveName != NULL)
+        {
+            checkpointCatch(&stop, &input);
+        }
+        if (seriesName != NULL || setsName != NULL)
+        {
+            if (nsims > 1 || hiers != NULL || sims[0].sample != NULL)
+            {
+                printf("-T and -H require a single cache size and set-associativity, and no -L2 or -s\n"
+                       "Exiting...\n");
+                exit(EXIT_FAILURE);
+            }
+            monitor = &monitorState;
+            if (monitorOpen(monitor, &sims[0].cache, seriesName, seriesInterval, setsName, input.first,
+                            orderBase, &sims[0].stats) != 0)
+            {
+                perror("Could not create the time series or set counters");
+                exit(EXIT_FAILURE);
+            }
+        }
 
-                offset = MEM << (index_size + tag_size);
-                offset = offset >> (index_size + tag_size);
-
-                Index = MEM >> offset_size; /*erase first offset_size bits of ProgramCounter*/
-                Index = Index << (offset_size + tag_size); /*erase upper tag_size bits of ProgramCounter*/
-                Index = Index >> (tag_size + offset_size); /*Move Index bits all the way to the right side*/
-
-                tag = MEM >> (index_size + offset_size);
+        /*With more than 1 thread, the caches of a sweep simulate each chunk of the trace in parallel,
+         * while a single cache is split by set over the threads, unless it is indexed between chunks or its
+         * accesses are counted one at a time*/
+        if (threads > 1 && nsims == 1 && !verboseState && hiers == NULL && !indexing && sims[0].sample == NULL &&
+            sims[0].pcs == NULL && sims[0].classes == NULL && sims[0].prefetch == NULL && monitor == NULL)
+        {
+            next = kwayRunPartitioned(&sims[0], &input, threads);
+        }
+        else
+        {
+            if (threads > 1)
+            {
+                pool = poolCreate(threads);
+                if (pool == NULL)
+                {
+                    perror("Could not start the worker threads");
+                    exit(EXIT_FAILURE);
+                }
+            }
+            next = poolRunTrace(pool, &input, simList, nsims, hiers != NULL ? hierRun : kwayRun);
+        }
+        if (next < 0)
+        {
+            printf("Had trouble with reading line %" PRId64 " of trace\nExiting...\n", trace.line);
+            exit(EXIT_FAILURE);
+        }
+        if (pool != NULL)
+        {
+            poolDestroy(pool);
+        }
+        if (monitor != NULL && monitorClose(monitor, next - 1, &sims[0].stats) != 0)
+        {
+            perror("Could not write the time series or set counters");
+            exit(EXIT_FAILURE);
+        }
+        if (eventLog != NULL && eventLogClose(eventLog) != 0)
+        {
+            perror("Could not write the event log");
+            exit(EXIT_FAILURE);
+        }
+        if (indexName != NULL && indexClose(&index) != 0)
+        {
+            perror("Could not write the index");
+            exit(EXIT_FAILURE);
+        }
+        if (saveName != NULL)
+        {
+            if (stop.stopped)
+            {
+                printf("Interrupted before access %" PRId64 ", saving the cache to %s\n", stop.order - orderBase,
+                       saveName);
+            }
+            if (checkpointSave(saveName, &sims[0].cache, &sims[0].stats, &trace, next,
+                               stop.stopped ? stop.offset : traceOffset(&trace), stop.stopped ? stop.line : trace.line)
+                != 0)
+            {
+                perror("Could not write the checkpoint");
+                exit(EXIT_FAILURE);
+            }
+        }
 
-                if (Ld_St == 'L')
+        for (i = 0; i < nsims; i++)
+        {
+            if (nsims > 1)
+            {
+                if (blockArg != NULL)
                 {
-                    /*Case 1: Hit, read*/
-                    for (i = 0; i < k; i++)
-                    {
-                        if (tag == kCache[Index].tag[i] && kCache[Index].valid[i] == 1)
-                        {
-                            selectedBlock = i;
-                            foundAddress = 1;
-                            break;
-                        }
-                    }
-                    /*the block containing A is found in index I id D in the data cache*/
-                    if (foundAddress)
-                    {
-                        dbit = kCache[Index].dbit[selectedBlock]; /*for verbose mode*/
-                        lastUsed = kCache[Index].LU[selectedBlock]; /*for verbose mode*/
-                        chosenBlock = selectedBlock; /*for verbose mode*/
-                        cTag = kCache[Index].tag[selectedBlock]; /*for verbose mode*/
-                        valid = kCache[Index].valid[selectedBlock]; /*for verbose mode*/
-                        caseCompleted = 1;
-                        caseNum = "1";
-                        kCache[Index].LU[selectedBlock] = order;
-                        readCycles += 1;
-                        hitOrMiss = 1;
-                    }
+                    printf("\ncache size = %gKB, k = %d, block size = %dB\n", sims[i].cache.input_cachesize,
+                           sims[i].cache.k, sims[i].cache.blockSize);
+                }
+                else
+                {
+                    printf("\ncache size = %gKB, k = %d\n", sims[i].cache.input_cachesize, sims[i].cache.k);
+                }
+            }
+            if (hiers != NULL)
+            {
+                hierPrint(&hiers[i]);
+                hierFree(&hiers[i]);
+            }
+            else
+            {
+                kwayPrint(&sims[i]);
+            }
+            kwayFree(&sims[i]);
+        }
+        free(hiers);
+        free(sims);
+        free(simList);
+        traceClose(&trace);
 
+    } /*End of input code block*/
+    else
+    {
+        usage();
+    }
 
-                    /*Case 2a: Clean miss, read*/
-                    if (!caseCompleted)
-                    {
-                        for (i = 0; i < k; i++)
-                        {
-                            if (kCache[Index].valid[i] == 0)
-                            {
-                                if (firstEmptyBlock == -1)
-                                {
-                                    firstEmptyBlock = i;
-                                    dbit = kCache[Index].dbit[firstEmptyBlock]; /*for verbose mode*/
-                                    lastUsed = kCache[Index].LU[firstEmptyBlock]; /*for verbose mode*/
-                                    chosenBlock = firstEmptyBlock; /*for verbose mode*/
-                                    cTag = kCache[Index].tag[firstEmptyBlock]; /*for verbose mode*/
-                                    valid = kCache[Index].valid[firstEmptyBlock]; /*for verbose mode*/
-                                    kCache[Index].tag[firstEmptyBlock] = tag;
-                                    kCache[Index].valid[firstEmptyBlock] = 1;
-                                    kCache[Index].dbit[firstEmptyBlock] = 0;
-                                    kCache[Index].LU[firstEmptyBlock] = order;
-                                    readCycles += (1 + MISS_PENALTY);
-                                    bytesRead += 16;
-                                    caseNum = "2a";
-                                    caseCompleted = 1;
-                                    hitOrMiss = 0;
-                                    readMisses++;
-                                    dataMisses++;
-                                }
-                                break;
-                            }
-                        }
-                    }
-                    /*Case 2a: clean miss, read*/
-                    /*Since no empty blocks were found, replace the block with the smallest LU*/
-                    if (firstEmptyBlock == -1 && !caseCompleted)
-                    {
-                        foundPair = 0;
-                        minIndex = 0;
-                        for (i = 0; i < (k - 1); i++)
-                        {
-                            if (tag != kCache[Index].tag[minIndex] && kCache[Index].dbit[minIndex] == 0 &&
-                                kCache[Index].valid[minIndex] == 1)
-                            {
-                                if (tag != kCache[Index].tag[i + 1] && kCache[Index].dbit[i + 1] == 0
-                                    && kCache[Index].valid[i + 1] == 1)
-                                {
-                                    foundPair = 1;
-
-                                    /*Compare block k and block k+1 in pairs, for all possible pairs,
-                                     * in order to find the block with the smallest LU value*/
-                                    if (kCache[Index].LU[minIndex] <= kCache[Index].LU[i+1])
-                                    {
-                                        continue;
-                                    }
-                                    else if (kCache[Index].LU[i] > kCache[Index].LU[i])
-                                    {
-                                        minIndex = i + 1;
-                                    }
-                                }
-                            }
-                        }
-                        selectedBlock = minIndex;
-                        /*If a clean miss occurred*/
-                        if(foundPair)
-                        {
-                            dbit = kCache[Index].dbit[selectedBlock]; /*for verbose mode*/
-                            lastUsed = kCache[Index].LU[selectedBlock]; /*for verbose mode*/
-                            chosenBlock = selectedBlock; /*for verbose mode*/
-                            cTag = kCache[Index].tag[selectedBlock]; /*for verbose mode*/
-                            valid = kCache[Index].valid[selectedBlock]; /*for verbose mode*/
-                            kCache[Index].tag[selectedBlock] = tag;
-                            kCache[Index].valid[selectedBlock] = 1;
-                            kCache[Index].dbit[selectedBlock] = 0;
-                            kCache[Index].LU[selectedBlock] = order;
-                            readCycles += (1 + MISS_PENALTY);
-                            bytesRead += 16;
-                            caseCompleted = 1;
-                            caseNum = "2a";
-                            hitOrMiss = 0;
-                            readMisses++;
-                            dataMisses++;
-                        }
-                    }
 
+    return 0;
+}
 
-                    /*Case 2b: Dirty miss, read*/
-                    /*It is assumed that there is only 1 hit/miss per scanned line, even if both
-                    * dirty and a clean misses occur within the same set of blocks, all matched
-                     * to the same tag*/
-                    if (!caseCompleted)
-                    {
-                        foundPair = 0;
-                        minIndex = 0;
-                        for (i = 0; i < k - 1; i++)
-                        {
-                            if (tag != kCache[Index].tag[minIndex] && kCache[Index].dbit[minIndex] == 1 &&
-                                kCache[Index].valid[minIndex] == 1)
-                            {
-
-                                if (tag != kCache[Index].tag[i + 1] && kCache[Index].dbit[i + 1] == 0 &&
-                                    kCache[Index].valid[i + 1] == 1)
-                                {
-                                    foundPair = 1;
-                                    if (kCache[Index].LU[minIndex] <= kCache[Index].LU[i+1])
-                                    {
-                                        continue;
-                                    }
-                                    else if (kCache[Index].LU[i] > kCache[Index].LU[i])
-                                    {
-                                        minIndex = i + 1;
-                                    }
-                                }
-                            }
-                        }
-                        selectedBlock = minIndex;
-                        if(selectedBlock != -1)
-                        {
-                            dbit = kCache[Index].dbit[selectedBlock]; /*for verbose mode*/
-                            lastUsed = kCache[Index].LU[selectedBlock]; /*for verbose mode*/
-                            chosenBlock = selectedBlock; /*for verbose mode*/
-                            cTag = kCache[Index].tag[selectedBlock]; /*for verbose mode*/
-                            valid = kCache[Index].valid[selectedBlock]; /*for verbose mode*/
-                            kCache[Index].tag[selectedBlock] = tag;
-                            kCache[Index].valid[selectedBlock] = 1;
-                            kCache[Index].dbit[selectedBlock] = 0;
-                            kCache[Index].LU[selectedBlock] = order;
-                            readCycles += (1 + 2 * MISS_PENALTY);
-                            bytesRead += 16;
-                            bytesWritten += 16;
-                            caseCompleted = 1;
-                            caseNum = "2b";
-                            hitOrMiss = 0;
-                            dReadMisses++;
-                            readMisses++;
-                            dataMisses++;
-                        }
+/*Simulate a chunk of the trace, the first record of which is access # first.
+ * Each chunk runs through one cache at a time, so only that cache competes with the chunk for the host's data cache*/
+void kwayRun(void* arg, const struct TraceRecord* records, int n, int64_t first)
+{
+    struct KwaySim* sim = arg;
+    int j;
 
-                    }
+    if (sim->sample != NULL)
+    {
+        sampleRun(sim->sample, &sim->cache, records, n, first);
+        return;
+    }
+    if (!verboseState && sim->pcs == NULL && sim->classes == NULL && sim->prefetch == NULL && monitor == NULL)
+    {
+        cacheSimulateBatch(&sim->cache, records, (size_t) n, first, &sim->stats);
+        return;
+    }
+    if (!verboseState && sim->pcs == NULL && sim->classes == NULL && sim->prefetch == NULL && monitor->sets == NULL)
+    {
+        monitorBatch(monitor, &sim->cache, records, n, first, &sim->stats);
+        return;
+    }
 
-                    dataReads++;
-                    firstEmptyBlock = -1;
-                } /*end of load*/
-                else if (Ld_St == 'S')
-                {
-                    /*Case 1: Hit, write*/
-                    for (i = 0; i < k; i++)
-                    {
-                        if (tag == kCache[Index].tag[i] && kCache[Index].valid[i] == 1)
-                        {
-                            selectedBlock = i;
-                            foundAddress = 1;
-                            caseCompleted = 1;
-                            break;
-                        }
-                    }
-                    /*the block containing A is found in index I id D in the data cache*/
-                    if (foundAddress)
-                    {
-                        dbit = kCache[Index].dbit[selectedBlock]; /*for verbose mode*/
-                        lastUsed = kCache[Index].LU[selectedBlock]; /*for verbose mode*/
-                        chosenBlock = selectedBlock; /*for verbose mode*/
-                        cTag = kCache[Index].tag[selectedBlock]; /*for verbose mode*/
-                        valid = kCache[Index].valid[selectedBlock]; /*for verbose mode*/
-                        caseNum = "1";
-                        kCache[Index].LU[selectedBlock] = order;
-                        kCache[Index].dbit[selectedBlock] = 1;
-                        kCache[Index].valid[selectedBlock] = 1;
-                        kCache[Index].tag[selectedBlock] = tag;
-                        writeCycles += 1;
-                        hitOrMiss = 1;
-                    }
+    /*One access at a time, for verbose mode, the counters of -P, -H and -C and the prefetcher of -F*/
+    for (j = 0; j < n; j++)
+    {
+        int64_t order = first + j;
+        unsigned long cycles = sim->stats.readCycles + sim->stats.writeCycles;
 
-                    /*Case 2a: Clean miss, write*/
-                    if (!caseCompleted)
-                    {
-                        /*Look for an empty block to fetch the address from MEM into*/
-                        for (i = 0; i < k; i++)
-                        {
-                            if (kCache[Index].valid[i] == 0)
-                            {
-                                if (firstEmptyBlock == -1)
-                                {
-                                    firstEmptyBlock = i;
-                                    dbit = kCache[Index].dbit[firstEmptyBlock]; /*for verbose mode*/
-                                    lastUsed = kCache[Index].LU[firstEmptyBlock]; /*for verbose mode*/
-                                    chosenBlock = firstEmptyBlock; /*for verbose mode*/
-                                    cTag = kCache[Index].tag[firstEmptyBlock]; /*for verbose mode*/
-                                    valid = kCache[Index].valid[firstEmptyBlock]; /*for verbose mode*/
-                                    kCache[Index].tag[firstEmptyBlock] = tag;
-                                    kCache[Index].valid[firstEmptyBlock] = 1;
-                                    kCache[Index].dbit[firstEmptyBlock] = 1;
-                                    kCache[Index].LU[firstEmptyBlock] = order;
-                                    writeCycles += (1 + MISS_PENALTY);
-                                    bytesWritten += 16;
-                                    caseNum = "2a";
-                                    caseCompleted = 1;
-                                    hitOrMiss = 0;
-                                    writeMisses++;
-                                    dataMisses++;
-                                }
-                                break;
-                            }
-                        }
-                    }
+        if (sim->prefetch != NULL)
+        {
+            cycles = prefetchAccess(sim->prefetch, &sim->cache, &records[j], order, &sim->stats);
+        }
+        else
+        {
+            cacheAccess(&sim->cache, traceOp(&records[j]), records[j].mem, order, &sim->stats);
+            cycles = sim->stats.readCycles + sim->stats.writeCycles - cycles;
+        }
+        if (sim->pcs != NULL &&
+            pcCount(sim->pcs, records[j].pc & TRACE_PC_MASK, traceOp(&records[j]) == 'S', cycles) != 0)
+        {
+            perror("Could not grow the instruction table");
+            exit(EXIT_FAILURE);
+        }
+        if (sim->classes != NULL &&
+            classifyAccess(sim->classes, traceOp(&records[j]) == 'S', records[j].mem, cycles > 1) != 0)
+        {
+            perror("Could not grow the set of seen blocks");
+            exit(EXIT_FAILURE);
+        }
+        if (monitor != NULL)
+        {
+            monitorAccess(monitor, &sim->cache, order, cycles, &sim->stats);
+        }
 
-                    /*If there were no empty blocks, replace the block with the smallest LU value*/
-                    if (firstEmptyBlock == -1 && !caseCompleted)
-                    {
-                        foundPair = 0;
-                        minIndex = 0;
-                        for (i = 0; i < (k - 1); i++)
-                        {
-                            if (tag != kCache[Index].tag[minIndex] && kCache[Index].dbit[minIndex] == 0 &&
-                                kCache[Index].valid[minIndex] == 1)
-                            {
-                                if (tag != kCache[Index].tag[i + 1] && kCache[Index].dbit[i + 1] == 0
-                                    && kCache[Index].valid[i + 1] == 1)
-                                {
-                                    foundPair = 1;
-                                    if (kCache[Index].LU[minIndex] <= kCache[Index].LU[i+1])
-                                    {
-                                        continue;
-                                    }
-                                    else if (kCache[Index].LU[i] > kCache[Index].LU[i])
-                                    {
-                                        minIndex = i + 1;
-                                    }
-                                }
-                            }
-                        }
-                        selectedBlock = minIndex;
-                        if(foundPair)
-                        {
-                            dbit = kCache[Index].dbit[selectedBlock]; /*for verbose mode*/
-                            lastUsed = kCache[Index].LU[selectedBlock]; /*for verbose mode*/
-                            chosenBlock = selectedBlock; /*for verbose mode*/
-                            cTag = kCache[Index].tag[selectedBlock]; /*for verbose mode*/
-                            valid = kCache[Index].valid[selectedBlock]; /*for verbose mode*/
-                            kCache[Index].tag[selectedBlock] = tag;
-                            kCache[Index].valid[selectedBlock] = 1;
-                            kCache[Index].dbit[selectedBlock] = 1;
-                            kCache[Index].LU[selectedBlock] = order;
-                            writeCycles += (1 + MISS_PENALTY);
-                            bytesWritten += 16;
-                            caseCompleted = 1;
-                            caseNum = "2a";
-                            hitOrMiss = 0;
-                            writeMisses++;
-                            dataMisses++;
-                        }
-                    }
+        /*Verbose output*/
+        if (verboseState && (order - orderBase >= ic1 && order - orderBase <= ic2))
+        {
+            if (eventLog != NULL)
+            {
+                eventLogAccess(eventLog, &sim->cache, order, orderBase, records[j].mem);
+                continue;
+            }
 
-                    /*Case 2b: Dirty miss, write*/
-                    /*Replace the block with the smallest LU value*/
-                    if (!caseCompleted)
-                    {
-                        foundPair = 0;
-                        minIndex = 0;
-                        for (i = 0; i < k - 1; i++)
-                        {
-                            if (tag != kCache[Index].tag[minIndex] && kCache[Index].dbit[minIndex] == 1 &&
-                                kCache[Index].valid[minIndex] == 1)
-                            {
-                                if (tag != kCache[Index].tag[i + 1] && kCache[Index].dbit[i + 1] == 0
-                                    && kCache[Index].valid[i + 1] == 1)
-                                {
-                                    foundPair = 1;
-                                    if (kCache[Index].LU[minIndex] <= kCache[Index].LU[i+1])
-                                    {
-                                        continue;
-                                    }
-                                    else if (kCache[Index].LU[i] > kCache[Index].LU[i])
-                                    {
-                                        minIndex = i + 1;
-                                    }
-                                }
-                            }
-                        }
-                        selectedBlock = minIndex;
-                        if(foundPair)
-                        {
-                            dbit = kCache[Index].dbit[selectedBlock]; /*for verbose mode*/
-                            lastUsed = kCache[Index].LU[selectedBlock]; /*for verbose mode*/
-                            chosenBlock = selectedBlock; /*for verbose mode*/
-                            cTag = kCache[Index].tag[selectedBlock]; /*for verbose mode*/
-                            valid = kCache[Index].valid[selectedBlock]; /*for verbose mode*/
-                            kCache[Index].tag[selectedBlock] = tag;
-                            kCache[Index].valid[selectedBlock] = 1;
-                            kCache[Index].dbit[selectedBlock] = 1;
-                            kCache[Index].LU[selectedBlock] = order;
-                            writeCycles += (1 + 2 * MISS_PENALTY);
-                            bytesWritten += 16;
-                            bytesRead += 16;
-                            caseCompleted = 1;
-                            caseNum = "2b";
-                            hitOrMiss = 0;
-                            dataMisses++;
-                            dWriteMisses++;
-                            writeMisses++;
-                        }
-                    }
+            if (count == 0)
+            {
+                printf("\n--The Terminal should be in full screen to ensure that the verbose mode output is " \
+                       "printed correctly--\n");
+                verbose("%-10s\t%-12s\t%-12s\t%-12s\t%-10s\t%-10s\t%-10s\t" \
+                    "%-12s\t%-10s\t%-10s\t%-10s\n",
+                        str1, str2, str3, str4, str5, str6, str7, str8, str9, str10, str11);
+            }
 
-                    dataWrites++;
-                    firstEmptyBlock = -1;
-                    caseCompleted = 0;
-                }
+            verbose("%-10" PRId64 "\t%-12" PRIx64 "\t%-12" PRIx64 "\t%-12" PRIx64 "\t%-10d\t%-10d\t%-10" PRId64 "\t" \
+                    "%-12" PRIx64 "\t%-10d\t%-10d\t%-10s\n",
+                    order - orderBase, records[j].mem, sim->cache.last.Index, sim->cache.last.tag,
+                    sim->cache.last.valid, sim->cache.last.chosenBlock, sim->cache.last.lastUsed - orderBase,
+                    sim->cache.last.cTag, sim->cache.last.dbit, sim->cache.last.hitOrMiss,
+                    eventCases[sim->cache.last.caseNum]);
+            count++;
+        }
+    }
+}
 
+/*Simulate one record of a set-partitioned run*/
+void kwayStep(void* arg, const struct TraceRecord* record, int64_t order)
+{
+    struct KwaySim* sim = arg;
 
-                /*Verbose output*/
-                if (argc == 7 && (order >= ic1 && order <= ic2))
-                {
+    cacheAccess(&sim->cache, traceOp(record), record->mem, order, &sim->stats);
+}
 
-                    if (count == 0)
-                    {
-                        printf("\n--The Terminal should be in full screen to ensure that the verbose mode output is " \
-                               "printed correctly--\n");
-                        verbose("%-10s\t%-12s\t%-12s\t%-12s\t%-10s\t%-10s\t%-10s\t" \
-                            "%-12s\t%-10s\t%-10s\t%-10s\n",
-                                str1, str2, str3, str4, str5, str6, str7, str8, str9, str10, str11);
-                    }
+/*Split sim by set over threads workers, each with its own statistics, see poolRunPartitioned.
+ * Each set still sees its accesses in trace order, so the totals match a serial run exactly*/
+int64_t kwayRunPartitioned(struct KwaySim* sim, const struct PoolInput* input, int threads)
+{
+    struct KwaySim* parts;
+    void** partList;
+    int64_t next;
+    int w;
 
-                    verbose("%-10d\t%-12" PRIx64 "\t%-12" PRIx64 "\t%-12" PRIx64 "\t%-10d\t%-10d\t%-10d\t" \
-                            "%-12" PRIx64 "\t%-10d\t%-10d\t%-10s\n",
-                            order, MEM, Index, tag, valid, chosenBlock, lastUsed, cTag, dbit, hitOrMiss, caseNum);
-                    count++;
-                }
+    if (threads > sim->cache.sets)
+    {
+        threads = sim->cache.sets;
+    }
+    parts = calloc((size_t) threads, sizeof(*parts));
+    partList = calloc((size_t) threads, sizeof(*partList));
+    if (parts == NULL || partList == NULL)
+    {
+        perror("Could not allocate the set-partition workers");
+        exit(EXIT_FAILURE);
+    }
+    for (w = 0; w < threads; w++)
+    {
+        parts[w].cache = sim->cache; /*Shares the cache lines*/
+        partList[w] = &parts[w];
+    }
 
-                order++;
-                dataAccesses++;
-                foundAddress = 0;
-                selectedBlock = -1;
-                caseCompleted = 0;
-                caseNum = "NULL";
-                dbit = 0;
-            } /*end of load || store*/
+    next = poolRunPartitioned(input, partList, threads, sim->cache.offset_size, sim->cache.index_size, kwayStep);
 
+    for (w = 0; w < threads; w++)
+    {
+        cacheStatsAdd(&sim->stats, &parts[w].stats);
+    }
+    free(parts);
+    free(partList);
+    return next;
+}
 
+/*Set up hier with sim as its L1, and the levels below given as "cachesize,k[,latency]" in levelArgs[1..]*/
+void kwayHierarchy(struct Hierarchy* hier, const struct KwaySim* sim, const char** levelArgs, enum Inclusion inclusion,
+                   const struct Policy* policy)
+{
+    static const int latencies[HIER_LEVELS] = {L1_LATENCY, L2_LATENCY, L3_LATENCY};
+    int i;
 
-        } /*end of while*/
+    hierInit(hier, sim->cache.blockSize, inclusion, CACHE_MISS_PENALTY);
+    hierAddLevel(hier, sim->cache.input_cachesize, sim->cache.k, L1_LATENCY, policy);
+    for (i = 1; i < HIER_LEVELS && levelArgs[i] != NULL; i++)
+    {
+        double cachesize;
+        int k;
+        int latency = latencies[i];
 
-        printf("\nnumber of data reads = %d\n", dataReads);
-        printf("number of data writes = %d\n", dataWrites);
-        printf("number of data accesses = %d\n", dataAccesses);
-        printf("number of total data read misses = %d\n", readMisses);
-        printf("number of total data write misses = %d\n", writeMisses);
-        printf("number of data misses = %lu\n", dataMisses);
-        printf("number of dirty data read misses = %d\n", dReadMisses);
-        printf("number of dirty write misses = %d\n", dWriteMisses);
-        printf("number of bytes read from memory = %lu\n", bytesRead);
-        printf("number of bytes written to memory = %lu\n", bytesWritten);
-        printf("total access time (in cycles) for reads = %lu\n", readCycles);
-        printf("total access time (in cycles) for writes = %lu\n", writeCycles);
-        if (dataAccesses > 0)
+        if (sscanf(levelArgs[i], "%lf,%d,%d", &cachesize, &k, &latency) < 2 ||
+            hierAddLevel(hier, cachesize, k, latency, policy) != 0)
         {
-            missRate = (double) (readMisses + writeMisses) / dataAccesses;
+            printf("L%d must be cachesize,k[,latency] with cachesize*1024/%d a power of 2 multiple of k\n"
+                   "Exiting...\n", i + 1, sim->cache.blockSize);
+            exit(EXIT_FAILURE);
         }
-        printf("overall data cache miss rate = %f\n", missRate);
+    }
+}
 
-        for (i = 0; i < set_size; i++)
+/*Set up sim as an empty k-way cache of input_cachesize KB with blocks of blockSize bytes (0 for CACHE_BLOCK_SIZE),
+ * exiting if that is not a valid cache*/
+/*sampleRate < 1 simulates only that fraction of the sets, unless the cache has too few to sample*/
+void kwayInit(struct KwaySim* sim, double input_cachesize, int k, const struct Policy* policy, double sampleRate,
+              int blockSize)
+{
+    struct CacheConfig config = {CACHE_KWAY, input_cachesize, k, policy, blockSize};
+    const char* error;
+
+    memset(&sim->stats, 0, sizeof(sim->stats));
+    sim->sample = NULL;
+    sim->pcs = NULL;
+    sim->classes = NULL;
+    sim->prefetch = NULL;
+    if (cacheInit(&sim->cache, &config, &error) != 0)
+    {
+        printf("%s\n", error);
+        exit(EXIT_FAILURE);
+    }
+    if (sampleRate < 1.0)
+    {
+        sim->sample = malloc(sizeof(*sim->sample));
+        if (sim->sample == NULL || sampleInit(sim->sample, &sim->cache, sampleRate) != 0)
         {
-            free(kCache[i].valid);
-            free(kCache[i].dbit);
-            free(kCache[i].tag);
-            free(kCache[i].LU);
+            printf("cache size = %gKB, k = %d has too few sets to sample, simulating all of them\n",
+                   input_cachesize, sim->cache.k);
+            free(sim->sample);
+            sim->sample = NULL;
         }
-        free(kCache);
+    }
+}
 
-    } /*End of input code block*/
-    else
+/*The statistics of a sampled cache, estimated for all of its sets*/
+void kwayPrintSample(const struct KwaySim* sim)
+{
+    struct SampleEstimate e;
+
+    sampleEstimate(sim->sample, &sim->cache, &e);
+    printf("\nsampled %d of %d sets (%g%%), with 95%% confidence intervals\n", sim->sample->sampledSets,
+           sim->cache.sets, 100.0 * sim->sample->sampledSets / sim->cache.sets);
+    printf("number of data reads = %lu +/- %lu\n", e.total.dataReads, e.margin.dataReads);
+    printf("number of data writes = %lu +/- %lu\n", e.total.dataWrites, e.margin.dataWrites);
+    printf("number of data accesses = %lu +/- %lu\n", e.total.dataAccesses, e.margin.dataAccesses);
+    printf("number of total data read misses = %lu +/- %lu\n", e.total.readMisses, e.margin.readMisses);
+    printf("number of total data write misses = %lu +/- %lu\n", e.total.writeMisses, e.margin.writeMisses);
+    printf("number of data misses = %lu +/- %lu\n", e.total.dataMisses, e.margin.dataMisses);
+    printf("number of dirty data read misses = %lu +/- %lu\n", e.total.dReadMisses, e.margin.dReadMisses);
+    printf("number of dirty write misses = %lu +/- %lu\n", e.total.dWriteMisses, e.margin.dWriteMisses);
+    printf("number of bytes read from memory = %lu +/- %lu\n", e.total.bytesRead, e.margin.bytesRead);
+    printf("number of bytes written to memory = %lu +/- %lu\n", e.total.bytesWritten, e.margin.bytesWritten);
+    printf("total access time (in cycles) for reads = %lu +/- %lu\n", e.total.readCycles, e.margin.readCycles);
+    printf("total access time (in cycles) for writes = %lu +/- %lu\n", e.total.writeCycles, e.margin.writeCycles);
+    printf("overall data cache miss rate = %f +/- %f\n", e.missRate, e.missRateMargin);
+}
+
+void kwayPrint(const struct KwaySim* sim)
+{
+    double missRate = 0.0;
+
+    if (sim->sample != NULL)
     {
-        printf("Arguments required: tracefile cachesize [-v ic1 ic2]\nExiting...\n");
-        exit(EXIT_FAILURE);
+        kwayPrintSample(sim);
+        return;
     }
 
+    printf("\nnumber of data reads = %lu\n", sim->stats.dataReads);
+    printf("number of data writes = %lu\n", sim->stats.dataWrites);
+    printf("number of data accesses = %lu\n", sim->stats.dataAccesses);
+    printf("number of total data read misses = %lu\n", sim->stats.readMisses);
+    printf("number of total data write misses = %lu\n", sim->stats.writeMisses);
+    printf("number of data misses = %lu\n", sim->stats.dataMisses);
+    printf("number of dirty data read misses = %lu\n", sim->stats.dReadMisses);
+    printf("number of dirty write misses = %lu\n", sim->stats.dWriteMisses);
+    printf("number of bytes read from memory = %lu\n", sim->stats.bytesRead);
+    printf("number of bytes written to memory = %lu\n", sim->stats.bytesWritten);
+    printf("total access time (in cycles) for reads = %lu\n", sim->stats.readCycles);
+    printf("total access time (in cycles) for writes = %lu\n", sim->stats.writeCycles);
+    if (sim->stats.dataAccesses > 0)
+    {
+        missRate = (double) (sim->stats.readMisses + sim->stats.writeMisses) / sim->stats.dataAccesses;
+    }
+    printf("overall data cache miss rate = %f\n", missRate);
+    if (sim->prefetch != NULL)
+    {
+        prefetchPrint(sim->prefetch, &sim->stats);
+    }
+    if (sim->classes != NULL)
+    {
+        classifyPrint(sim->classes);
+    }
+    if (sim->pcs != NULL)
+    {
+        pcPrint(sim->pcs, pcTop);
+    }
+}
 
-    return 0;
+void kwayFree(struct KwaySim* sim)
+{
+    if (sim->sample != NULL)
+    {
+        sampleFree(sim->sample);
+        free(sim->sample);
+    }
+    if (sim->pcs != NULL)
+    {
+        pcTableFree(sim->pcs);
+        free(sim->pcs);
+    }
+    if (sim->classes != NULL)
+    {
+        classifyFree(sim->classes);
+        free(sim->classes);
+    }
+    if (sim->prefetch != NULL)
+    {
+        prefetchFree(sim->prefetch);
+        free(sim->prefetch);
+    }
+    cacheFree(&sim->cache);
 }
 
 void setVerbose(int state)
@@ -662,3 +978,13 @@ int verbose(const char* format, ...)
         return result;
     }
 }
+
+/*Print the arguments and exit*/
+void usage(void)
+{
+    printf("Arguments required: tracefile cachesize set-associativity [-v ic1 ic2] [-j threads] [-b records] "
+           "[-l logfile] [-I indexfile] [-n interval] [-x] [-S checkpoint] [-R|-W checkpoint] [-p policy] "
+           "[-L2 cachesize,k[,latency]] [-L3 cachesize,k[,latency]] [-i inclusion] [-s rate] [-P top] "
+           "[-T seriesfile] [-N interval] [-H setsfile] [-C] [-B blocksizes] [-F prefetcher]\nExiting...\n");
+    exit(EXIT_FAILURE);
+}
@@ -0,0 +1,53 @@
+/*tagmatch.c
+  Choice of the tag match kernel, see tagmatch.h.
+  The kernel is picked by a constructor before main runs, so the worker threads only ever read it.
+  */
+
+#include "tagmatch.h"
+
+static enum TagMatchIsa isa = TAGMATCH_SCALAR;
+
+static const char* const kernels[TAGMATCH_ISAS] = {"scalar", "sse4.1", "avx2"};
+
+__attribute__((constructor))
+static void tagMatchSelect(void)
+{
+#ifdef TAGMATCH_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+    {
+        isa = TAGMATCH_AVX2;
+    }
+    else if (__builtin_cpu_supports("sse4.1"))
+    {
+        isa = TAGMATCH_SSE41;
+    }
+#endif
+}
+
+uint64_t tagMatch(const uint64_t* tags, const uint64_t* lines, int n, uint64_t tag, uint64_t* invalid)
+{
+    switch (isa)
+    {
+#ifdef TAGMATCH_X86
+        case TAGMATCH_AVX2:
+            return tagMatchAvx2(tags, lines, n, tag, invalid);
+        case TAGMATCH_SSE41:
+            return tagMatchSse41(tags, lines, n, tag, invalid);
+#endif
+        default:
+            return tagMatchScalar(tags, lines, n, tag, invalid);
+    }
+}
+
+/*Instruction set of the kernel in use*/
+enum TagMatchIsa tagMatchIsa(void)
+{
+    return isa;
+}
+
+/*Name of the kernel in use*/
+const char* tagMatchKernel(void)
+{
+    return kernels[isa];
+}
@@ -0,0 +1,116 @@
+/*tagmatch.h
+  Compares a tag with every way of a set at once. The ways are given as their tags and packed lines
+  (see cacheline.h), the result is a bit mask with bit i set if way i is valid and holds the tag,
+  and *invalid gets a mask of the invalid ways. Up to 64 ways per call.
+  The kernels are inline, one per instruction set, so that a caller built for that instruction set with a
+  constant n gets the compare unrolled into its own code. tagMatchIsa() is the best one the CPU has, chosen once
+  at startup, and tagMatch() calls it for the callers that are not specialized.
+  The valid bit of a packed line is its sign bit, so a movemask of the lines gives the valid ways directly,
+  and one 64-bit compare per way gives the ways holding the tag.
+  */
+
+#ifndef TAGMATCH_H
+#define TAGMATCH_H
+
+#include <stdint.h>
+
+#include "cacheline.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define TAGMATCH_X86 1
+#endif
+
+#define TAGMATCH_WAYS 64 /*Most ways compared by one call*/
+
+enum TagMatchIsa
+{
+    TAGMATCH_SCALAR,
+    TAGMATCH_SSE41,
+    TAGMATCH_AVX2,
+    TAGMATCH_ISAS
+};
+
+/*Ways from..n-1, one at a time*/
+static inline uint64_t tagMatchTail(const uint64_t* tags, const uint64_t* lines, int from, int n, uint64_t tag,
+                                    uint64_t* invalid)
+{
+    uint64_t hit = 0;
+    int i;
+
+    for (i = from; i < n; i++)
+    {
+        if (!lineValid(lines[i]))
+        {
+            *invalid |= (uint64_t) 1 << i;
+        }
+        else if (tags[i] == tag)
+        {
+            hit |= (uint64_t) 1 << i;
+        }
+    }
+    return hit;
+}
+
+static inline uint64_t tagMatchScalar(const uint64_t* tags, const uint64_t* lines, int n, uint64_t tag,
+                                      uint64_t* invalid)
+{
+    *invalid = 0;
+    return tagMatchTail(tags, lines, 0, n, tag, invalid);
+}
+
+#ifdef TAGMATCH_X86
+/*4 ways per compare*/
+__attribute__((target("avx2")))
+static inline uint64_t tagMatchAvx2(const uint64_t* tags, const uint64_t* lines, int n, uint64_t tag,
+                                    uint64_t* invalid)
+{
+    __m256i key = _mm256_set1_epi64x((long long) tag);
+    uint64_t empty = 0;
+    uint64_t hit = 0;
+    int i;
+
+    for (i = 0; i + 4 <= n; i += 4)
+    {
+        __m256i equal = _mm256_cmpeq_epi64(_mm256_loadu_si256((const __m256i*) (tags + i)), key);
+        __m256i line = _mm256_loadu_si256((const __m256i*) (lines + i));
+        unsigned int valid = (unsigned int) _mm256_movemask_pd(_mm256_castsi256_pd(line));
+        unsigned int same = (unsigned int) _mm256_movemask_pd(_mm256_castsi256_pd(equal));
+
+        hit |= (uint64_t) (same & valid) << i;
+        empty |= (uint64_t) (~valid & 0xF) << i;
+    }
+    *invalid = empty;
+    return hit | tagMatchTail(tags, lines, i, n, tag, invalid);
+}
+
+/*2 ways per compare*/
+__attribute__((target("sse4.1")))
+static inline uint64_t tagMatchSse41(const uint64_t* tags, const uint64_t* lines, int n, uint64_t tag,
+                                     uint64_t* invalid)
+{
+    __m128i key = _mm_set1_epi64x((long long) tag);
+    uint64_t empty = 0;
+    uint64_t hit = 0;
+    int i;
+
+    for (i = 0; i + 2 <= n; i += 2)
+    {
+        __m128i equal = _mm_cmpeq_epi64(_mm_loadu_si128((const __m128i*) (tags + i)), key);
+        __m128i line = _mm_loadu_si128((const __m128i*) (lines + i));
+        unsigned int valid = (unsigned int) _mm_movemask_pd(_mm_castsi128_pd(line));
+        unsigned int same = (unsigned int) _mm_movemask_pd(_mm_castsi128_pd(equal));
+
+        hit |= (uint64_t) (same & valid) << i;
+        empty |= (uint64_t) (~valid & 0x3) << i;
+    }
+    *invalid = empty;
+    return hit | tagMatchTail(tags, lines, i, n, tag, invalid);
+}
+#endif
+
+uint64_t tagMatch(const uint64_t* tags, const uint64_t* lines, int n, uint64_t tag, uint64_t* invalid);
+enum TagMatchIsa tagMatchIsa(void);
+const char* tagMatchKernel(void);
+
+#endif
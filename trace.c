@@ -0,0 +1,817 @@
+/*trace.c
+  Trace reader shared by system1.c and system2.c, see trace.h.
+  Each trace line has 14 fields, but only ProgramCounter, Ld_St and MEM are converted,
+  everything else is skipped over without being parsed. Lines which are not loads or stores
+  are dropped as soon as Ld_St has been read.
+  Gzip compressed traces are recognized by their magic bytes and inflated on a separate thread,
+  which hands blocks of complete lines to the parser through a small bounded queue.
+  Binary traces written by trace2bin.c are recognized by TRACE_BINARY_MAGIC and their records
+  are returned as they are, without any parsing.
+  */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <zlib.h>
+
+#include "trace.h"
+
+#define TRACE_GZ_BLOCKS 4 /*Blocks in the queue between the inflating thread and the parser*/
+#define TRACE_GZ_INPUT_SIZE (1 << 18)
+
+struct GzStream
+{
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t queued; /*Signalled when a block is queued or the stream ends*/
+    pthread_cond_t released; /*Signalled when the parser hands a block back*/
+    char* blocks[TRACE_GZ_BLOCKS];
+    size_t sizes[TRACE_GZ_BLOCKS]; /*Capacity of each block*/
+    size_t lengths[TRACE_GZ_BLOCKS]; /*# of bytes of complete lines in each queued block*/
+    int head; /*Oldest queued block, which is the one the parser reads*/
+    int count; /*# of queued blocks, including the one being parsed*/
+    int holding; /*1 while the parser is reading blocks[head]*/
+    int done;
+    int error;
+    int stop;
+    int started;
+
+    /*Only used by the inflating thread*/
+    int fd;
+    const unsigned char* input; /*Compressed trace, if it was memory-mapped*/
+    size_t inputLength;
+    unsigned char* inbuf; /*Compressed bytes read from fd otherwise*/
+    size_t pending; /*# of bytes already in inbuf when the thread starts*/
+    char* carry; /*Partial line at the end of the last queued block*/
+    size_t carryLength;
+    size_t carrySize;
+};
+
+static int isBlank(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+}
+
+static const char* skipBlanks(const char* p, const char* end)
+{
+    while (p < end && isBlank(*p))
+    {
+        p++;
+    }
+    return p;
+}
+
+/*Skip one whitespace separated field, returns NULL if the line ends before the field*/
+static const char* skipField(const char* p, const char* end)
+{
+    if (p == NULL)
+    {
+        return NULL;
+    }
+    p = skipBlanks(p, end);
+    if (p == end || *p == '\n')
+    {
+        return NULL;
+    }
+    while (p < end && !isBlank(*p) && *p != '\n')
+    {
+        p++;
+    }
+    return p;
+}
+
+static int hexDigit(char c)
+{
+    if (c >= '0' && c <= '9')
+    {
+        return c - '0';
+    }
+    c |= 0x20; /*lower case*/
+    if (c >= 'a' && c <= 'f')
+    {
+        return c - 'a' + 10;
+    }
+    return -1;
+}
+
+/*Convert one hex field, with or without the 0x prefix, the same way %SCNx64 did*/
+static const char* parseHex(const char* p, const char* end, uint64_t* value)
+{
+    uint64_t result = 0;
+    const char* digits;
+    int d;
+
+    if (p == NULL)
+    {
+        return NULL;
+    }
+    p = skipBlanks(p, end);
+    if (end - p >= 2 && p[0] == '0' && (p[1] | 0x20) == 'x')
+    {
+        p += 2;
+    }
+    digits = p;
+    while (p < end && (d = hexDigit(*p)) >= 0)
+    {
+        result = (result << 4) | (uint64_t) d;
+        p++;
+    }
+    if (p == digits || (p < end && !isBlank(*p) && *p != '\n'))
+    {
+        return NULL;
+    }
+    *value = result;
+    return p;
+}
+
+static const char* nextLine(const char* p, const char* end)
+{
+    const char* newline = memchr(p, '\n', (size_t) (end - p));
+
+    return newline == NULL ? end : newline + 1;
+}
+
+static int isGzip(const unsigned char* bytes)
+{
+    return bytes[0] == 0x1f && bytes[1] == 0x8b;
+}
+
+static int isBinary(const char* bytes)
+{
+    return memcmp(bytes, TRACE_BINARY_MAGIC, 4) == 0;
+}
+
+/*Wait for a free block, returns -1 if the reader is being closed*/
+static int gzFreeBlock(struct GzStream* gz)
+{
+    int slot;
+
+    pthread_mutex_lock(&gz->lock);
+    while (gz->count == TRACE_GZ_BLOCKS && !gz->stop)
+    {
+        pthread_cond_wait(&gz->released, &gz->lock);
+    }
+    slot = gz->stop ? -1 : (gz->head + gz->count) % TRACE_GZ_BLOCKS;
+    pthread_mutex_unlock(&gz->lock);
+    return slot;
+}
+
+/*Inflating thread. Fills free blocks with decompressed lines until the trace ends,
+ * concatenated gzip members are inflated one after the other*/
+static void* gzInflate(void* arg)
+{
+    struct GzStream* gz = arg;
+    z_stream zs;
+    int error = 0;
+    size_t inputLeft = 0; /*Bytes of the mapping not yet handed to zs*/
+    int inputDone;
+    int memberDone = 0;
+    int streamDone = 0;
+
+    memset(&zs, 0, sizeof(zs));
+    if (inflateInit2(&zs, 15 + 32) != Z_OK) /*+32: accept both gzip and zlib headers*/
+    {
+        error = 1;
+    }
+    if (gz->input != NULL)
+    {
+        zs.next_in = (Bytef*) gz->input;
+        zs.avail_in = 0;
+        inputLeft = gz->inputLength;
+        inputDone = inputLeft == 0;
+    }
+    else
+    {
+        zs.next_in = gz->inbuf;
+        zs.avail_in = (uInt) gz->pending;
+        inputDone = 0;
+    }
+
+    while (!streamDone && !error)
+    {
+        int slot = gzFreeBlock(gz);
+        char* block;
+        size_t length;
+        size_t lines;
+
+        if (slot < 0)
+        {
+            break;
+        }
+
+        block = gz->blocks[slot];
+        memcpy(block, gz->carry, gz->carryLength);
+        length = gz->carryLength;
+
+        while (1)
+        {
+            int ret;
+
+            if (length == gz->sizes[slot])
+            {
+                if (memchr(block, '\n', length) != NULL)
+                {
+                    break;
+                }
+                /*A single line longer than the block*/
+                block = realloc(block, 2 * gz->sizes[slot]);
+                if (block == NULL)
+                {
+                    error = 1;
+                    break;
+                }
+                gz->blocks[slot] = block;
+                gz->sizes[slot] *= 2;
+            }
+            if (zs.avail_in == 0 && !inputDone && gz->input != NULL)
+            {
+                /*avail_in is a uInt, so a mapping over 4 GiB is fed in slices, each starting where
+                 * inflate left next_in*/
+                size_t slice = inputLeft < UINT_MAX ? inputLeft : UINT_MAX;
+
+                zs.avail_in = (uInt) slice;
+                inputLeft -= slice;
+                inputDone = inputLeft == 0;
+                continue;
+            }
+            if (zs.avail_in == 0 && !inputDone)
+            {
+                ssize_t n = read(gz->fd, gz->inbuf, TRACE_GZ_INPUT_SIZE);
+                if (n < 0 && errno == EINTR)
+                {
+                    continue;
+                }
+                if (n < 0)
+                {
+                    error = 1;
+                    break;
+                }
+                inputDone = n == 0;
+                zs.next_in = gz->inbuf;
+                zs.avail_in = (uInt) n;
+                continue;
+            }
+            if (memberDone)
+            {
+                if (zs.avail_in == 0)
+                {
+                    streamDone = 1;
+                    break;
+                }
+                inflateReset(&zs);
+                memberDone = 0;
+            }
+
+            zs.next_out = (Bytef*) block + length;
+            zs.avail_out = (uInt) (gz->sizes[slot] - length);
+            ret = inflate(&zs, Z_NO_FLUSH);
+            length = gz->sizes[slot] - zs.avail_out;
+            if (ret == Z_STREAM_END)
+            {
+                memberDone = 1;
+            }
+            else if (ret == Z_BUF_ERROR && zs.avail_in == 0 && inputDone)
+            {
+                error = 1; /*Truncated trace*/
+                break;
+            }
+            else if (ret != Z_OK && ret != Z_BUF_ERROR)
+            {
+                error = 1;
+                break;
+            }
+        }
+        if (block == NULL)
+        {
+            break;
+        }
+
+        /*Queue complete lines only, the rest is carried over to the next block*/
+        lines = length;
+        if (!streamDone)
+        {
+            while (lines > 0 && block[lines - 1] != '\n')
+            {
+                lines--;
+            }
+        }
+        gz->carryLength = length - lines;
+        if (gz->carryLength > gz->carrySize)
+        {
+            char* grown = realloc(gz->carry, gz->carryLength);
+            if (grown == NULL)
+            {
+                error = 1;
+                break;
+            }
+            gz->carry = grown;
+            gz->carrySize = gz->carryLength;
+        }
+        memcpy(gz->carry, block + lines, gz->carryLength);
+
+        if (lines > 0)
+        {
+            pthread_mutex_lock(&gz->lock);
+            gz->lengths[slot] = lines;
+            gz->count++;
+            pthread_cond_signal(&gz->queued);
+            pthread_mutex_unlock(&gz->lock);
+        }
+    }
+
+    inflateEnd(&zs);
+    pthread_mutex_lock(&gz->lock);
+    gz->done = 1;
+    gz->error = error;
+    pthread_cond_signal(&gz->queued);
+    pthread_mutex_unlock(&gz->lock);
+    return NULL;
+}
+
+/*Start inflating either a mapped trace (input != NULL) or fd, of which the first
+ * pendingLength bytes have already been read into pending*/
+static int gzStart(struct TraceReader* tr, const char* input, size_t inputLength,
+                   const char* pending, size_t pendingLength)
+{
+    struct GzStream* gz = calloc(1, sizeof(*gz));
+    int i;
+
+    if (gz == NULL)
+    {
+        return -1;
+    }
+    pthread_mutex_init(&gz->lock, NULL);
+    pthread_cond_init(&gz->queued, NULL);
+    pthread_cond_init(&gz->released, NULL);
+    gz->fd = tr->fd;
+    gz->input = (const unsigned char*) input;
+    gz->inputLength = inputLength;
+    gz->carrySize = TRACE_BUFFER_SIZE;
+    gz->carry = malloc(gz->carrySize);
+    if (input == NULL)
+    {
+        gz->inbuf = malloc(TRACE_GZ_INPUT_SIZE);
+        if (gz->inbuf != NULL)
+        {
+            memcpy(gz->inbuf, pending, pendingLength);
+        }
+        gz->pending = pendingLength;
+    }
+    for (i = 0; i < TRACE_GZ_BLOCKS; i++)
+    {
+        gz->sizes[i] = TRACE_BUFFER_SIZE;
+        gz->blocks[i] = malloc(gz->sizes[i]);
+    }
+    tr->gz = gz;
+    for (i = 0; i < TRACE_GZ_BLOCKS; i++)
+    {
+        if (gz->blocks[i] == NULL)
+        {
+            return -1;
+        }
+    }
+    if (gz->carry == NULL || (input == NULL && gz->inbuf == NULL)
+        || pthread_create(&gz->thread, NULL, gzInflate, gz) != 0)
+    {
+        return -1;
+    }
+    gz->started = 1;
+    tr->cur = NULL;
+    tr->end = NULL;
+    return 0;
+}
+
+/*Hand the block being parsed back to the inflating thread and wait for the next one*/
+static int gzFill(struct TraceReader* tr)
+{
+    struct GzStream* gz = tr->gz;
+    int result;
+
+    pthread_mutex_lock(&gz->lock);
+    if (gz->holding)
+    {
+        gz->head = (gz->head + 1) % TRACE_GZ_BLOCKS;
+        gz->count--;
+        gz->holding = 0;
+        pthread_cond_signal(&gz->released);
+    }
+    while (gz->count == 0 && !gz->done)
+    {
+        pthread_cond_wait(&gz->queued, &gz->lock);
+    }
+    if (gz->count > 0)
+    {
+        tr->cur = gz->blocks[gz->head];
+        tr->end = tr->cur + gz->lengths[gz->head];
+        gz->holding = 1;
+        result = 1;
+    }
+    else
+    {
+        result = gz->error ? -1 : 0;
+    }
+    pthread_mutex_unlock(&gz->lock);
+    return result;
+}
+
+static void gzClose(struct GzStream* gz)
+{
+    int i;
+
+    if (gz->started)
+    {
+        pthread_mutex_lock(&gz->lock);
+        gz->stop = 1;
+        pthread_cond_signal(&gz->released);
+        pthread_mutex_unlock(&gz->lock);
+        pthread_join(gz->thread, NULL);
+    }
+    for (i = 0; i < TRACE_GZ_BLOCKS; i++)
+    {
+        free(gz->blocks[i]);
+    }
+    free(gz->inbuf);
+    free(gz->carry);
+    pthread_cond_destroy(&gz->queued);
+    pthread_cond_destroy(&gz->released);
+    pthread_mutex_destroy(&gz->lock);
+    free(gz);
+}
+
+/*Refill buf for unmapped input. The chunk handed to the parser ends after the last complete line
+ * (or record, for binary traces), the partial line behind it is moved to the front of buf before the next read.
+ * Returns 1 if a chunk is ready, 0 at the end of the trace and -1 on a read error*/
+static int traceFill(struct TraceReader* tr)
+{
+    size_t tail;
+    size_t i;
+    int complete = 0;
+
+    if (tr->gz != NULL)
+    {
+        return gzFill(tr);
+    }
+    if (tr->buf == NULL)
+    {
+        return 0; /*A mapped trace is a single chunk*/
+    }
+
+    tail = tr->filled - (size_t) (tr->end - tr->buf);
+    memmove(tr->buf, tr->end, tail);
+    tr->filled = tail;
+
+    while (!complete && !tr->eof)
+    {
+        ssize_t n;
+
+        if (tr->filled == tr->bufSize)
+        {
+            /*A single line longer than the buffer (never happens with binary records)*/
+            char* grown = realloc(tr->buf, 2 * tr->bufSize);
+            if (grown == NULL)
+            {
+                return -1;
+            }
+            tr->buf = grown;
+            tr->bufSize *= 2;
+        }
+        n = read(tr->fd, tr->buf + tr->filled, tr->bufSize - tr->filled);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return -1;
+        }
+        if (n == 0)
+        {
+            tr->eof = 1;
+        }
+        if (tr->binary)
+        {
+            complete = tr->filled + (size_t) n >= sizeof(struct TraceRecord);
+        }
+        else
+        {
+            complete = memchr(tr->buf + tr->filled, '\n', (size_t) n) != NULL;
+        }
+        tr->filled += (size_t) n;
+    }
+
+    i = tr->filled;
+    if (tr->binary)
+    {
+        i -= i % sizeof(struct TraceRecord); /*A cut off record at the very end is ignored*/
+    }
+    else if (!tr->eof)
+    {
+        while (tr->buf[i - 1] != '\n')
+        {
+            i--;
+        }
+    }
+    tr->cur = tr->buf;
+    tr->end = tr->buf + i;
+    return i > 0;
+}
+
+/*Check the header of a binary trace. A mapped trace becomes a single chunk of records,
+ * otherwise the header is dropped from buf and the records are read like text lines*/
+static int binaryStart(struct TraceReader* tr, const struct TraceBinaryHeader* header)
+{
+    if (header->version != TRACE_BINARY_VERSION)
+    {
+        traceClose(tr);
+        errno = EINVAL;
+        return -1;
+    }
+    tr->binary = 1;
+    if (tr->map != NULL)
+    {
+        size_t records = (tr->mapLength - sizeof(*header)) / sizeof(struct TraceRecord);
+
+        if (header->count != 0 && header->count < records) /*0: written to a pipe, count unknown*/
+        {
+            records = (size_t) header->count;
+        }
+        tr->cur = tr->map + sizeof(*header);
+        tr->end = tr->cur + records * sizeof(struct TraceRecord);
+    }
+    else
+    {
+        tr->filled = 0;
+    }
+    return 0;
+}
+
+int traceOpen(struct TraceReader* tr, const char* filename)
+{
+    struct stat st;
+
+    memset(tr, 0, sizeof(*tr));
+    if (strcmp(filename, "-") == 0)
+    {
+        tr->fd = STDIN_FILENO;
+    }
+    else
+    {
+        tr->fd = open(filename, O_RDONLY);
+        if (tr->fd < 0)
+        {
+            return -1;
+        }
+    }
+
+    if (fstat(tr->fd, &st) == 0 && S_ISREG(st.st_mode))
+    {
+        if (st.st_size == 0)
+        {
+            tr->eof = 1;
+            return 0;
+        }
+        tr->map = mmap(NULL, (size_t) st.st_size, PROT_READ, MAP_PRIVATE, tr->fd, 0);
+        if (tr->map != MAP_FAILED)
+        {
+            madvise(tr->map, (size_t) st.st_size, MADV_SEQUENTIAL);
+            tr->mapLength = (size_t) st.st_size;
+            tr->cur = tr->map;
+            tr->end = tr->map + tr->mapLength;
+            if (tr->mapLength >= sizeof(struct TraceBinaryHeader) && isBinary(tr->map))
+            {
+                return binaryStart(tr, (const struct TraceBinaryHeader*) tr->map);
+            }
+            if (tr->mapLength >= 2 && isGzip((const unsigned char*) tr->map)
+                && gzStart(tr, tr->map, tr->mapLength, NULL, 0) != 0)
+            {
+                traceClose(tr);
+                return -1;
+            }
+            return 0;
+        }
+        tr->map = NULL;
+    }
+
+    tr->bufSize = TRACE_BUFFER_SIZE;
+    tr->buf = malloc(tr->bufSize);
+    if (tr->buf == NULL)
+    {
+        traceClose(tr);
+        return -1;
+    }
+    tr->cur = tr->buf;
+    tr->end = tr->buf;
+
+    /*Peek at the magic bytes, they stay in buf if the trace turns out to be plain text*/
+    while (tr->filled < sizeof(struct TraceBinaryHeader) && !tr->eof)
+    {
+        ssize_t n = read(tr->fd, tr->buf + tr->filled, sizeof(struct TraceBinaryHeader) - tr->filled);
+        if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (n < 0)
+        {
+            traceClose(tr);
+            return -1;
+        }
+        tr->eof = n == 0;
+        tr->filled += (size_t) n;
+    }
+    if (tr->filled == sizeof(struct TraceBinaryHeader) && isBinary(tr->buf))
+    {
+        return binaryStart(tr, (const struct TraceBinaryHeader*) tr->buf);
+    }
+    if (tr->filled >= 2 && isGzip((const unsigned char*) tr->buf))
+    {
+        if (gzStart(tr, NULL, 0, tr->buf, tr->filled) != 0)
+        {
+            traceClose(tr);
+            return -1;
+        }
+        free(tr->buf);
+        tr->buf = NULL;
+        tr->filled = 0;
+    }
+    return 0;
+}
+
+/*Read the next load or store of the trace.
+ * Returns 1 if a record was read, 0 at the end of the trace and -1 if line tr->line could not be read*/
+int traceNext(struct TraceReader* tr, uint64_t* pc, char* ldSt, uint64_t* mem)
+{
+    if (tr->binary)
+    {
+        const struct TraceRecord* record;
+
+        if (tr->cur >= tr->end)
+        {
+            int filled = traceFill(tr);
+            if (filled <= 0)
+            {
+                return filled;
+            }
+        }
+        record = (const struct TraceRecord*) tr->cur;
+        tr->cur += sizeof(*record);
+        tr->line++;
+        *pc = record->pc & TRACE_PC_MASK;
+        *ldSt = traceOp(record);
+        *mem = record->mem;
+        return *ldSt == 'L' || *ldSt == 'S' ? 1 : -1;
+    }
+
+    while (1)
+    {
+        const char* p;
+        const char* end;
+        char op;
+
+        if (tr->cur >= tr->end)
+        {
+            int filled = traceFill(tr);
+            if (filled <= 0)
+            {
+                return filled;
+            }
+        }
+        p = tr->cur;
+        end = tr->end;
+        tr->line++;
+
+        p = skipBlanks(p, end);
+        if (p == end || *p == '\n')
+        {
+            tr->cur = p == end ? end : p + 1; /*Blank line*/
+            continue;
+        }
+
+        p = skipField(p, end); /*micro-op count*/
+        p = parseHex(p, end, pc);
+        p = skipField(p, end); /*source register 1*/
+        p = skipField(p, end); /*source register 2*/
+        p = skipField(p, end); /*destination register*/
+        p = skipField(p, end); /*condition flags read*/
+        p = skipField(p, end); /*condition flags written*/
+        if (p != NULL)
+        {
+            p = skipBlanks(p, end);
+        }
+        if (p == NULL || p == end || *p == '\n')
+        {
+            tr->cur = nextLine(tr->cur, end);
+            return -1;
+        }
+        op = *p;
+
+        if (op == 'L' || op == 'S')
+        {
+            p = skipField(p, end); /*Ld_St*/
+            p = skipField(p, end); /*immediate*/
+            p = parseHex(p, end, mem);
+            if (p == NULL)
+            {
+                tr->cur = nextLine(tr->cur, end);
+                return -1;
+            }
+            *ldSt = op;
+            tr->cur = nextLine(p, end);
+            return 1;
+        }
+        tr->cur = nextLine(p, end);
+    }
+}
+
+/*Read up to max loads and stores into records, with Ld_St packed into the top byte of pc.
+ * Returns the # of records read, 0 at the end of the trace and -1 if line tr->line could not be read*/
+int traceRead(struct TraceReader* tr, struct TraceRecord* records, int max)
+{
+    int n = 0;
+
+    while (n < max)
+    {
+        uint64_t pc;
+        uint64_t mem;
+        char ldSt;
+        int result = traceNext(tr, &pc, &ldSt, &mem);
+
+        if (result < 0)
+        {
+            return -1;
+        }
+        if (result == 0)
+        {
+            break;
+        }
+        records[n].pc = (pc & TRACE_PC_MASK) | ((uint64_t) (unsigned char) ldSt << TRACE_OP_SHIFT);
+        records[n].mem = mem;
+        n++;
+    }
+    return n;
+}
+
+/*Byte offset of the next unread line or record, which traceSeek can return to.
+ * Only a memory-mapped trace that is not compressed can seek, -1 for any other*/
+long long traceOffset(const struct TraceReader* tr)
+{
+    if (tr->map == NULL || tr->gz != NULL)
+    {
+        return -1;
+    }
+    return tr->cur - tr->map;
+}
+
+/*Continue reading at offset, which traceOffset returned when line was the last line read.
+ * Returns -1 if the trace cannot seek or offset is past its end*/
+int traceSeek(struct TraceReader* tr, long long offset, int64_t line)
+{
+    if (tr->map == NULL || tr->gz != NULL || offset < 0 || offset > tr->end - tr->map)
+    {
+        return -1;
+    }
+    tr->cur = tr->map + offset;
+    tr->line = line;
+    return 0;
+}
+
+/*FNV-1a hash of the first TRACE_FINGERPRINT bytes of a mapped trace, which together with mapLength tells
+ * whether something saved from a trace belongs to this one. 0 if the trace is not mapped*/
+uint64_t traceFingerprint(const struct TraceReader* tr)
+{
+    uint64_t hash = 0xCBF29CE484222325ULL;
+    size_t i;
+
+    if (tr->map == NULL)
+    {
+        return 0;
+    }
+    for (i = 0; i < tr->mapLength && i < TRACE_FINGERPRINT; i++)
+    {
+        hash = (hash ^ (unsigned char) tr->map[i]) * 0x100000001B3ULL;
+    }
+    return hash;
+}
+
+void traceClose(struct TraceReader* tr)
+{
+    if (tr->gz != NULL)
+    {
+        gzClose(tr->gz);
+    }
+    if (tr->map != NULL)
+    {
+        munmap(tr->map, tr->mapLength);
+    }
+    free(tr->buf);
+    if (tr->fd > STDIN_FILENO)
+    {
+        close(tr->fd);
+    }
+    memset(tr, 0, sizeof(*tr));
+}
@@ -0,0 +1,71 @@
+/*trace.h
+  Trace reader shared by system1.c and system2.c.
+  Reads CIS501-format traces and returns only the three fields the simulators use:
+  ProgramCounter (field 2), Ld_St (field 8) and MEM (field 10).
+  Regular files are memory-mapped and parsed in place, anything else (pipes, stdin as "-")
+  is read through a large buffer. Gzip compressed traces, mapped or piped, are inflated on a
+  background thread while the simulation runs.
+  Binary traces (see trace2bin.c) hold one fixed-width record per load or store and are read
+  without any parsing.
+  */
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <inttypes.h>
+#include <stddef.h>
+
+#define TRACE_BUFFER_SIZE (1 << 20)
+
+#define TRACE_BINARY_MAGIC "CSTB"
+#define TRACE_BINARY_VERSION 1
+#define TRACE_OP_SHIFT 56 /*Ld_St is kept in the top byte of TraceRecord.pc*/
+#define TRACE_PC_MASK ((UINT64_C(1) << TRACE_OP_SHIFT) - 1)
+#define TRACE_FINGERPRINT 4096 /*# of bytes at the start of a trace hashed by traceFingerprint*/
+
+/*Binary trace layout: one header, followed by count records, all in host byte order*/
+struct TraceBinaryHeader
+{
+    char magic[4];
+    uint32_t version;
+    uint64_t count; /*# of records, 0 if unknown because the trace was written to a pipe*/
+};
+
+struct TraceRecord
+{
+    uint64_t pc; /*ProgramCounter in the low 56 bits, Ld_St in the top 8*/
+    uint64_t mem;
+};
+
+static inline char traceOp(const struct TraceRecord* record)
+{
+    return (char) (record->pc >> TRACE_OP_SHIFT);
+}
+
+struct GzStream;
+
+struct TraceReader
+{
+    int fd;
+    const char* cur; /*Next unparsed byte of the current chunk*/
+    const char* end; /*Chunks always end on a line boundary, or at the end of the trace*/
+    char* map; /*The whole trace, when it could be memory-mapped*/
+    size_t mapLength;
+    char* buf; /*Buffered fallback for input that cannot be mapped*/
+    size_t bufSize;
+    size_t filled; /*# of bytes of buf holding data, including the partial line after end*/
+    int eof;
+    int binary; /*1 if the trace holds TraceRecords instead of text lines*/
+    struct GzStream* gz; /*Background decompression, NULL for uncompressed traces*/
+    int64_t line; /*Line (or record #) of the trace the last record was read from, for error messages*/
+};
+
+int traceOpen(struct TraceReader* tr, const char* filename);
+int traceNext(struct TraceReader* tr, uint64_t* pc, char* ldSt, uint64_t* mem);
+int traceRead(struct TraceReader* tr, struct TraceRecord* records, int max);
+long long traceOffset(const struct TraceReader* tr);
+int traceSeek(struct TraceReader* tr, long long offset, int64_t line);
+uint64_t traceFingerprint(const struct TraceReader* tr);
+void traceClose(struct TraceReader* tr);
+
+#endif
@@ -0,0 +1,110 @@
+/*trace2bin.c
+  Converts a CIS501-format trace (plain or gzip compressed) into the binary trace format
+  described in trace.h, which system1.c and system2.c read without any parsing.
+  Only loads and stores are kept, since the simulators ignore every other line.
+  How to execute:
+    1) gcc -O2 -o trace2bin trace2bin.c trace.c -lz -lpthread
+    2) ./trace2bin gcc.trace.gz gcc.bin
+       ./sys2 gcc.bin 2 4
+  */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "trace.h"
+
+#define RECORD_BATCH 4096
+
+int main(int argc, char* argv[])
+{
+    struct TraceReader trace;
+    struct TraceBinaryHeader header;
+    struct TraceRecord* records;
+    FILE* out;
+    uint64_t count = 0;
+    size_t n = 0;
+    int scanLine;
+
+    if (argc != 3)
+    {
+        printf("Arguments required: tracefile binaryfile\nExiting...\n");
+        exit(EXIT_FAILURE);
+    }
+
+    if (traceOpen(&trace, argv[1]) != 0)
+    {
+        perror("File could not be found in the current working directory\nExiting...\n");
+        exit(EXIT_FAILURE);
+    }
+    out = strcmp(argv[2], "-") == 0 ? stdout : fopen(argv[2], "wb");
+    if (out == NULL)
+    {
+        perror("Could not create the binary trace");
+        exit(EXIT_FAILURE);
+    }
+    records = malloc(RECORD_BATCH * sizeof(*records));
+    if (records == NULL)
+    {
+        perror("Could not allocate the record buffer");
+        exit(EXIT_FAILURE);
+    }
+
+    /*The record count is filled in at the end, it stays 0 if out cannot be rewound*/
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, TRACE_BINARY_MAGIC, sizeof(header.magic));
+    header.version = TRACE_BINARY_VERSION;
+    fwrite(&header, sizeof(header), 1, out);
+
+    while (1)
+    {
+        uint64_t pc;
+        uint64_t mem;
+        char ldSt;
+
+        scanLine = traceNext(&trace, &pc, &ldSt, &mem);
+        if (scanLine == 0)
+        {
+            break;
+        }
+        if (scanLine < 0)
+        {
+            printf("Had trouble with reading line %" PRId64 " of trace\nExiting...\n", trace.line);
+            exit(EXIT_FAILURE);
+        }
+        if (pc > TRACE_PC_MASK)
+        {
+            printf("ProgramCounter %" PRIx64 " on line %" PRId64 " does not fit in 56 bits\nExiting...\n", pc,
+                   trace.line);
+            exit(EXIT_FAILURE);
+        }
+
+        records[n].pc = pc | ((uint64_t) (unsigned char) ldSt << TRACE_OP_SHIFT);
+        records[n].mem = mem;
+        n++;
+        count++;
+        if (n == RECORD_BATCH)
+        {
+            fwrite(records, sizeof(*records), n, out);
+            n = 0;
+        }
+    }
+    fwrite(records, sizeof(*records), n, out);
+
+    header.count = count;
+    if (out != stdout && fseek(out, 0, SEEK_SET) == 0)
+    {
+        fwrite(&header, sizeof(header), 1, out);
+    }
+    if (ferror(out) || fclose(out) != 0)
+    {
+        perror("Could not write the binary trace");
+        exit(EXIT_FAILURE);
+    }
+    fprintf(stderr, "%" PRIu64 " loads and stores converted\n", count);
+
+    free(records);
+    traceClose(&trace);
+    return 0;
+}
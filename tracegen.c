@@ -0,0 +1,131 @@
+/*tracegen.c
+  Writes a synthetic trace (see synth.h) in the CIS501 text format the simulators parse, or with -b in the
+  binary format of trace2bin.c. Only the fields the simulators read carry information, the others are filler.
+  How to execute:
+    1) gcc -O2 -o tracegen tracegen.c synth.c -lm
+    2) ./tracegen zipf 10000000 zipf.trace -f 8388608 -a 0.9 -w 0.25
+        (10M accesses over 8MB, 25% stores)
+       ./tracegen chase 1000000 chase.bin -f 1048576 -b
+       ./sys2 zipf.trace 64 8
+  */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "synth.h"
+#include "trace.h"
+
+#define RECORD_BATCH 4096
+
+static void usage(void)
+{
+    printf("Arguments required: sequential|strided|random|zipf|chase count tracefile [-f footprint] [-s stride] "
+           "[-w writes] [-a alpha] [-r seed] [-b]\nExiting...\n");
+    exit(EXIT_FAILURE);
+}
+
+int main(int argc, char* argv[])
+{
+    struct SynthConfig config = {SYNTH_SEQUENTIAL, 1 << 20, 64, 0.3, 0.99, 1};
+    struct Synth synth;
+    struct TraceRecord* records;
+    uint64_t count;
+    uint64_t done;
+    int binary = 0;
+    FILE* out;
+    int i;
+
+    if (argc < 4 || synthPattern(argv[1], &config.pattern) != 0)
+    {
+        usage();
+    }
+    count = strtoull(argv[2], NULL, 10);
+    for (i = 4; i < argc; i++)
+    {
+        if (strcmp(argv[i], "-f") == 0 && i + 1 < argc)
+        {
+            config.footprint = strtoull(argv[++i], NULL, 10);
+        }
+        else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc)
+        {
+            config.stride = strtoull(argv[++i], NULL, 10);
+        }
+        else if (strcmp(argv[i], "-w") == 0 && i + 1 < argc)
+        {
+            config.writes = atof(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-a") == 0 && i + 1 < argc)
+        {
+            config.alpha = atof(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-r") == 0 && i + 1 < argc)
+        {
+            config.seed = strtoull(argv[++i], NULL, 10);
+        }
+        else if (strcmp(argv[i], "-b") == 0)
+        {
+            binary = 1;
+        }
+        else
+        {
+            usage();
+        }
+    }
+
+    if (synthInit(&synth, &config) != 0)
+    {
+        printf("Could not set up the pattern, footprint must be >= 8 and stride >= 1\nExiting...\n");
+        exit(EXIT_FAILURE);
+    }
+    out = strcmp(argv[3], "-") == 0 ? stdout : fopen(argv[3], binary ? "wb" : "w");
+    records = malloc(RECORD_BATCH * sizeof(*records));
+    if (out == NULL || records == NULL)
+    {
+        perror("Could not create the trace");
+        exit(EXIT_FAILURE);
+    }
+
+    if (binary)
+    {
+        struct TraceBinaryHeader header;
+
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, TRACE_BINARY_MAGIC, sizeof(header.magic));
+        header.version = TRACE_BINARY_VERSION;
+        header.count = count;
+        fwrite(&header, sizeof(header), 1, out);
+    }
+    for (done = 0; done < count;)
+    {
+        int n = count - done < RECORD_BATCH ? (int) (count - done) : RECORD_BATCH;
+        int j;
+
+        synthFill(&synth, records, n);
+        if (binary)
+        {
+            fwrite(records, sizeof(*records), (size_t) n, out);
+        }
+        else
+        {
+            for (j = 0; j < n; j++)
+            {
+                uint64_t pc = records[j].pc & TRACE_PC_MASK;
+
+                fprintf(out, "1 0x%" PRIx64 " 0 0 0 - - %c 0 0x%" PRIx64 " 0x%" PRIx64 " 0x0 SYNTH %s\n", pc,
+                        traceOp(&records[j]), records[j].mem, pc + 4, traceOp(&records[j]) == 'S' ? "STORE" : "LOAD");
+            }
+        }
+        done += (uint64_t) n;
+    }
+    if (ferror(out) || fclose(out) != 0)
+    {
+        perror("Could not write the trace");
+        exit(EXIT_FAILURE);
+    }
+
+    free(records);
+    synthFree(&synth);
+    return 0;
+}
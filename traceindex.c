@@ -0,0 +1,189 @@
+/*traceindex.c
+  Sparse trace index, see traceindex.h.
+  An existing index is memory-mapped, and a seek binary searches its entries for the last checkpoint
+  at or before the access, copies it into the cache and moves the trace reader to its offset.
+  */
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "traceindex.h"
+
+/*Fill in what an index of trace for cache must match. Returns -1 if the trace cannot seek*/
+static int indexDescribe(struct IndexHeader* header, const struct TraceReader* trace, const struct Cache* cache)
+{
+    if (traceOffset(trace) < 0)
+    {
+        return -1;
+    }
+    memset(header, 0, sizeof(*header));
+    memcpy(header->magic, INDEX_MAGIC, sizeof(header->magic));
+    header->version = INDEX_VERSION;
+    header->traceLength = trace->mapLength;
+    header->traceHash = traceFingerprint(trace);
+    header->stateSize = cacheStateSize(cache);
+    header->kind = (int32_t) cache->kind;
+    header->k = cache->k;
+    header->sets = cache->sets;
+    header->blockSize = cache->blockSize;
+    if (cache->policy != NULL)
+    {
+        strncpy(header->policy, cache->policy->name, sizeof(header->policy) - 1);
+    }
+    return 0;
+}
+
+static size_t entrySize(const struct TraceIndex* index)
+{
+    return sizeof(struct IndexEntry) + (size_t) index->header.stateSize;
+}
+
+/*Map the index in filename. Returns 0, -1 if it could not be read, or -2 if it does not belong to
+ * this trace and cache (or the trace cannot seek)*/
+int indexOpen(struct TraceIndex* index, const char* filename, const struct TraceReader* trace, struct Cache* cache,
+              struct CacheStats* stats)
+{
+    struct IndexHeader expected;
+    struct IndexHeader* header;
+    struct stat st;
+    int fd;
+
+    memset(index, 0, sizeof(*index));
+    index->cache = cache;
+    index->stats = stats;
+    fd = open(filename, O_RDONLY);
+    if (fd < 0 || fstat(fd, &st) != 0 || (size_t) st.st_size < sizeof(*header))
+    {
+        if (fd >= 0)
+        {
+            close(fd);
+        }
+        return -1;
+    }
+    index->map = mmap(NULL, (size_t) st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (index->map == MAP_FAILED)
+    {
+        index->map = NULL;
+        return -1;
+    }
+    index->mapLength = (size_t) st.st_size;
+
+    header = (struct IndexHeader*) index->map;
+    if (indexDescribe(&expected, trace, cache) != 0 || header->interval <= 0)
+    {
+        return -2;
+    }
+    expected.interval = header->interval;
+    if (memcmp(header, &expected, sizeof(expected)) != 0)
+    {
+        return -2;
+    }
+    index->header = *header;
+    index->entries = (index->mapLength - sizeof(*header)) / entrySize(index);
+    return 0;
+}
+
+/*Start building an index in filename, with a checkpoint every interval accesses. indexMark writes them
+ * as poolRunTrace gets to them. Returns -1 if the trace cannot seek or filename could not be created*/
+int indexCreate(struct TraceIndex* index, const char* filename, const struct TraceReader* trace, struct Cache* cache,
+                struct CacheStats* stats, int interval)
+{
+    memset(index, 0, sizeof(*index));
+    index->cache = cache;
+    index->stats = stats;
+    index->next = interval;
+    if (interval <= 0 || indexDescribe(&index->header, trace, cache) != 0)
+    {
+        return -1;
+    }
+    index->header.interval = interval;
+    index->state = malloc((size_t) index->header.stateSize);
+    index->out = fopen(filename, "wb");
+    if (index->state == NULL || index->out == NULL ||
+        fwrite(&index->header, sizeof(index->header), 1, index->out) != 1)
+    {
+        return -1;
+    }
+    return 0;
+}
+
+/*The mark of a PoolInput: checkpoint the cache before access # first, at offset of the trace,
+ * if a checkpoint is due*/
+int indexMark(void* arg, int64_t first, long long offset, int64_t line)
+{
+    struct TraceIndex* index = arg;
+    struct IndexEntry entry;
+
+    if (index->out == NULL || first < index->next || offset < 0)
+    {
+        return 0;
+    }
+    index->next = first - first % index->header.interval + index->header.interval;
+
+    memset(&entry, 0, sizeof(entry));
+    entry.offset = offset;
+    entry.order = first;
+    entry.line = line;
+    cacheSave(index->cache, index->stats, index->state);
+    if (fwrite(&entry, sizeof(entry), 1, index->out) != 1 ||
+        fwrite(index->state, (size_t) index->header.stateSize, 1, index->out) != 1)
+    {
+        index->error = 1;
+    }
+    return 0;
+}
+
+/*Restore the last checkpoint at or before access # order, and move trace to it.
+ * Returns the # of the next access of trace, which is 0 if there is no such checkpoint*/
+int64_t indexSeek(struct TraceIndex* index, struct TraceReader* trace, int64_t order)
+{
+    const struct IndexEntry* entry = NULL;
+    size_t low = 0;
+    size_t high = index->entries;
+
+    while (low < high)
+    {
+        size_t middle = low + (high - low) / 2;
+        const struct IndexEntry* candidate =
+            (const struct IndexEntry*) (index->map + sizeof(index->header) + middle * entrySize(index));
+
+        if (candidate->order <= order)
+        {
+            entry = candidate;
+            low = middle + 1;
+        }
+        else
+        {
+            high = middle;
+        }
+    }
+    if (entry == NULL || traceSeek(trace, entry->offset, entry->line) != 0)
+    {
+        return 0;
+    }
+    cacheLoad(index->cache, index->stats, entry + 1);
+    return entry->order;
+}
+
+/*Returns -1 if the index being built could not be written*/
+int indexClose(struct TraceIndex* index)
+{
+    int error = index->error;
+
+    if (index->out != NULL && fclose(index->out) != 0)
+    {
+        error = 1;
+    }
+    if (index->map != NULL)
+    {
+        munmap(index->map, index->mapLength);
+    }
+    free(index->state);
+    memset(index, 0, sizeof(*index));
+    return error ? -1 : 0;
+}
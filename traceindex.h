@@ -0,0 +1,67 @@
+/*traceindex.h
+  Sparse index of a trace for one cache configuration: every interval accesses, the byte offset of the next
+  access in the trace and a checkpoint of the cache and its statistics (see cacheSave) as they were before it.
+  A run that only needs a window of the trace seeks to the last checkpoint before the window instead of
+  simulating everything before it. An index is built by any run of the configuration with -I, and covers
+  as much of the trace as that run simulated. Seeking needs a memory-mapped trace that is not compressed.
+  An index file is a header, then one entry followed by its checkpoint per interval, in host byte order.
+  */
+
+#ifndef TRACEINDEX_H
+#define TRACEINDEX_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "cachesim.h"
+#include "trace.h"
+
+#define INDEX_MAGIC "CSIX"
+#define INDEX_VERSION 4
+#define INDEX_INTERVAL (1 << 20) /*Default # of accesses between checkpoints*/
+
+struct IndexHeader
+{
+    char magic[4];
+    uint32_t version;
+    uint64_t traceLength; /*Size of the trace*/
+    uint64_t traceHash; /*traceFingerprint*/
+    uint64_t stateSize; /*Size of each checkpoint*/
+    int32_t interval;
+    int32_t kind; /*enum CacheKind*/
+    int32_t k;
+    int32_t sets;
+    int32_t blockSize;
+    char policy[16]; /*Name of the replacement policy, empty for the legacy victim search*/
+};
+
+struct IndexEntry
+{
+    int64_t offset; /*traceOffset of the access*/
+    int64_t order; /*# of the access*/
+    int64_t line; /*Last line of the trace read before it*/
+};
+
+struct TraceIndex
+{
+    FILE* out; /*Set while the index is being built*/
+    char* map; /*Set while an existing index is used*/
+    size_t mapLength;
+    size_t entries;
+    struct IndexHeader header;
+    struct Cache* cache;
+    struct CacheStats* stats;
+    unsigned char* state; /*Checkpoint being written*/
+    int64_t next; /*# of the access the next checkpoint is due at*/
+    int error;
+};
+
+int indexOpen(struct TraceIndex* index, const char* filename, const struct TraceReader* trace, struct Cache* cache,
+              struct CacheStats* stats);
+int indexCreate(struct TraceIndex* index, const char* filename, const struct TraceReader* trace, struct Cache* cache,
+                struct CacheStats* stats, int interval);
+int indexMark(void* index, int64_t first, long long offset, int64_t line);
+int64_t indexSeek(struct TraceIndex* index, struct TraceReader* trace, int64_t order);
+int indexClose(struct TraceIndex* index);
+
+#endif